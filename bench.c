@@ -0,0 +1,334 @@
+// Benchmarks ryu_string for every format against snprintf("%.17g") and the
+// upstream d2s_buffered function, over several input distributions,
+// ryu_parse_many against strtod, and ryu_series_string against ryu_string.
+//
+//   cc -O3 bench.c -o bench && ./bench
+//
+// The ryu.c file is included directly so that the internal d2s_buffered
+// function can be measured too, along with the 128-bit multiplication and
+// 64-bit division kernels of the path ryu.c was compiled for. Compare the
+// paths by building with -DRYU_ONLY_64_BIT_OPS (no 128-bit multiplication)
+// or -DRYU_32_BIT_PLATFORM (32-bit division helpers), or for the target, the
+// shared products of -DRYU_SHARED_MUL_SHIFT against the native ones, and
+// the tables with -DRYU_OPTIMIZE_SIZE, -DRYU_HOT_TABLES or -DRYU_LAZY_TABLES.
+// With -DRYU_PROFILE, the ticks of each conversion stage are printed last.
+
+#define RYU_EXTERN static inline
+#include "ryu.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#define NVALUES 100000
+#define BATCH 16
+#define ROUNDS 5
+#define NSAMPLES (NVALUES / BATCH * ROUNDS)
+// Room for the longest 'f' output, FIXED_MAX_LENGTH characters, so that
+// every format prints directly instead of through the truncation path.
+#define BUFSIZE 400
+
+static uint64_t seed = 88172645463325252ull;
+
+static uint64_t rand64(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+static double bits_to_double(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(double));
+    return d;
+}
+
+static void gen_random_bits(double *vals, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        do {
+            vals[i] = bits_to_double(rand64());
+        } while (!isfinite(vals[i]));
+    }
+}
+
+static void gen_small_ints(double *vals, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        vals[i] = (double) (rand64() >> (11 + rand64() % 53));
+    }
+}
+
+static void gen_subnormals(double *vals, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        vals[i] = bits_to_double(rand64() >> 12);
+    }
+}
+
+static void gen_near_1e21(double *vals, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const double r = (double) (rand64() >> 11) / 9007199254740992.0;
+        vals[i] = 1e21 * (0.5 + r);
+    }
+}
+
+struct dist {
+    const char *name;
+    void (*gen)(double *vals, size_t n);
+};
+
+static const struct dist dists[] = {
+    { "random bits", gen_random_bits },
+    { "small ints", gen_small_ints },
+    { "subnormals", gen_subnormals },
+    { "near 1e21", gen_near_1e21 },
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return x < y ? -1 : x > y;
+}
+
+static size_t sink;
+
+// Converts one value with method, which is a ryu_string format character,
+// 's' for snprintf or 'd' for d2s_buffered.
+static inline void convert(double d, char method, char *buf) {
+    switch (method) {
+    case 's':
+        sink += (size_t) snprintf(buf, BUFSIZE, "%.17g", d);
+        break;
+    case 'd':
+        d2s_buffered(d, buf);
+        sink += (size_t) buf[0];
+        break;
+    default:
+        sink += ryu_string(d, method, buf, BUFSIZE);
+    }
+}
+
+static void bench(const char *name, const double *vals, char method) {
+    static double samples[NSAMPLES];
+    char buf[BUFSIZE];
+    // Warm up.
+    for (size_t i = 0; i < NVALUES; i++) {
+        convert(vals[i], method, buf);
+    }
+    // Throughput, without timer calls in the loop.
+    double start = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < NVALUES; i++) {
+            convert(vals[i], method, buf);
+        }
+    }
+    const double mean = (now() - start) / (double) (ROUNDS * NVALUES);
+    // Latency, from batches of BATCH values.
+    size_t ns = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < NVALUES; i += BATCH) {
+            start = now();
+            for (size_t j = i; j < i + BATCH; j++) {
+                convert(vals[j], method, buf);
+            }
+            samples[ns++] = (now() - start) / BATCH;
+        }
+    }
+    qsort(samples, ns, sizeof(double), cmp_double);
+    const char *method_name = method == 's' ? "snprintf" :
+        method == 'd' ? "d2s_buffered" : NULL;
+    char fmt[2] = { method, '\0' };
+    printf("%-12s %-13s %8.2f %10.2f %8.2f %8.2f %8.2f\n", name,
+        method_name ? method_name : fmt, mean, 1e3 / mean,
+        samples[ns / 2], samples[ns * 9 / 10], samples[ns * 99 / 100]);
+}
+
+#if defined(HAS_SHARED_MUL_SHIFT) && defined(HAS_UINT128)
+#define MUL_PATH "uint128_t, shared"
+#elif defined(HAS_SHARED_MUL_SHIFT) && defined(HAS_64_BIT_INTRINSICS)
+#define MUL_PATH "intrinsics, shared"
+#elif defined(HAS_UINT128)
+#define MUL_PATH "uint128_t"
+#elif defined(HAS_64_BIT_INTRINSICS)
+#define MUL_PATH "intrinsics"
+#else
+#define MUL_PATH "32x32-bit, shared"
+#endif
+
+#if defined(RYU_32_BIT_PLATFORM)
+#define DIV_PATH "umulh"
+#else
+#define DIV_PATH "native"
+#endif
+
+#if defined(HAS_LAZY_TABLES) && defined(RYU_HOT_TABLES)
+#define TABLE_PATH "hot, lazy"
+#elif defined(HAS_LAZY_TABLES)
+#define TABLE_PATH "small, lazy"
+#elif defined(RYU_OPTIMIZE_SIZE)
+#define TABLE_PATH "small"
+#elif defined(RYU_HOT_TABLES)
+#define TABLE_PATH "hot"
+#else
+#define TABLE_PATH "full"
+#endif
+
+static uint64_t kernel_m[NVALUES];
+static uint64_t kernel_mul[NVALUES][2];
+static int32_t kernel_j[NVALUES];
+
+// Runs one kernel over every input: 'm' is mulShiftAll64 with operands like
+// those of d2d, and '1', '8' and '9' are div10, div1e8 and mod1e9.
+static inline uint64_t kernel(char k, size_t i) {
+    uint64_t vp, vm;
+    switch (k) {
+    case 'm':
+        return mulShiftAll64(kernel_m[i], kernel_mul[i], kernel_j[i], &vp, &vm, 
+            (uint32_t) (i & 1)) + vp + vm;
+    case '1':
+        return div10(kernel_m[i]);
+    case '8':
+        return div1e8(kernel_m[i]);
+    default:
+        return mod1e9(kernel_m[i]);
+    }
+}
+
+static void bench_kernel(const char *name, char k) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < NVALUES; i++) {
+        sum += kernel(k, i);
+    }
+    const double start = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < NVALUES; i++) {
+            sum += kernel(k, i);
+        }
+    }
+    const double mean = (now() - start) / (double) (ROUNDS * NVALUES);
+    sink += (size_t) sum;
+    printf("%-12s %-13s %8.2f %10.2f\n", "kernels", name, mean, 1e3 / mean);
+}
+
+static void bench_kernels(void) {
+    for (size_t i = 0; i < NVALUES; i++) {
+        // A 55-bit mantissa, a 124-bit power of 5 and a shift of at least
+        // 115, as in d2d.
+        kernel_m[i] = rand64() >> 9;
+        kernel_mul[i][0] = rand64();
+        kernel_mul[i][1] = rand64() >> 4;
+        kernel_j[i] = 115 + (int32_t) (rand64() % 8);
+    }
+    bench_kernel("mulShiftAll64", 'm');
+    bench_kernel("div10", '1');
+    bench_kernel("div1e8", '8');
+    bench_kernel("mod1e9", '9');
+}
+
+// Times reading back the 'j' output of every distribution, joined with
+// ",", with ryu_parse_many and with strtod on each token.
+static void bench_parse(double *vals) {
+    static double parsed[NVALUES];
+    static char text[NVALUES * 25];
+    printf("\n%-12s %12s %12s\n", "parse", "ryu ns/value", "strtod");
+    for (size_t i = 0; i < sizeof(dists) / sizeof(dists[0]); i++) {
+        dists[i].gen(vals, NVALUES);
+        const size_t len = ryu_string_many(vals, NVALUES, 'j', ",", text,
+            sizeof(text), NULL);
+        double start = now();
+        for (int r = 0; r < ROUNDS; r++) {
+            sink += ryu_parse_many(text, len, ",", parsed, NVALUES, NULL);
+        }
+        const double ryu = (now() - start) / (double) (ROUNDS * NVALUES);
+        start = now();
+        for (int r = 0; r < ROUNDS; r++) {
+            char *p = text;
+            for (size_t j = 0; j < NVALUES; j++) {
+                parsed[j] = strtod(p, &p);
+                p++;
+            }
+            sink += (size_t) parsed[NVALUES / 2];
+        }
+        const double libc = (now() - start) / (double) (ROUNDS * NVALUES);
+        printf("%-12s %12.2f %12.2f\n", dists[i].name, ryu, libc);
+    }
+}
+
+// A timestamp in seconds, advancing by a millisecond.
+static void gen_timestamps(double *vals, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        vals[i] = 1697059200.0 + (double) i / 1000;
+    }
+}
+
+// A gauge that changes every eighth sample, in its low digits.
+static void gen_gauge(double *vals, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        vals[i] = 101.3 + (double) (i / 8 % 100) / 100;
+    }
+}
+
+static void bench_series(double *vals) {
+    static const struct {
+        const char *name;
+        void (*gen)(double *vals, size_t n);
+    } series[] = {
+        { "timestamps", gen_timestamps },
+        { "gauge", gen_gauge },
+        { "random bits", gen_random_bits },
+    };
+    char buf[32];
+    printf("\n%-12s %12s %12s\n", "series", "ryu ns/value", "ryu_string");
+    for (size_t i = 0; i < sizeof(series) / sizeof(series[0]); i++) {
+        series[i].gen(vals, NVALUES);
+        double start = now();
+        for (int r = 0; r < ROUNDS; r++) {
+            struct ryu_series s = { .fmt = 'j' };
+            for (size_t j = 0; j < NVALUES; j++) {
+                sink += ryu_series_string(&s, vals[j], buf, sizeof(buf));
+            }
+        }
+        const double ryu = (now() - start) / (double) (ROUNDS * NVALUES);
+        start = now();
+        for (int r = 0; r < ROUNDS; r++) {
+            for (size_t j = 0; j < NVALUES; j++) {
+                sink += ryu_string(vals[j], 'j', buf, sizeof(buf));
+            }
+        }
+        const double plain = (now() - start) / (double) (ROUNDS * NVALUES);
+        printf("%-12s %12.2f %12.2f\n", series[i].name, ryu, plain);
+    }
+}
+
+int main(void) {
+    static double vals[NVALUES];
+    printf("multiply: %s, divide: %s, tables: %s\n\n", MUL_PATH, DIV_PATH,
+        TABLE_PATH);
+    static const char methods[] = "eEfgGjJds";
+    printf("%-12s %-13s %8s %10s %8s %8s %8s\n", "input", "format",
+        "ns/value", "Mvalues/s", "p50", "p90", "p99");
+    for (size_t i = 0; i < sizeof(dists) / sizeof(dists[0]); i++) {
+        dists[i].gen(vals, NVALUES);
+        for (const char *m = methods; *m; m++) {
+            bench(dists[i].name, vals, *m);
+        }
+    }
+    bench_kernels();
+    bench_parse(vals);
+    bench_series(vals);
+#ifdef RYU_PROFILE
+    static char dump[8192];
+    struct ryu_profile profile;
+    ryu_read_profile(&profile, false);
+    ryu_profile_dump(&profile, dump, sizeof(dump));
+    printf("\n%s", dump);
+#endif
+    return sink == 0;
+}
@@ -33,19 +33,161 @@
 // -DRYU_ONLY_64_BIT_OPS Avoid using uint128_t or 64-bit intrinsics. Slower,
 //     depending on your compiler.
 //
+// -DRYU_SHARED_MUL_SHIFT Compute vr, vp and vm of d2d from two shared
+//     64x64-bit products, instead of three independent 128-bit ones. Meant
+//     for AArch64, where the two halves of a product are separate mul and
+//     umulh instructions. Not the default until bench.c shows the gain on
+//     real hardware.
+//
 // -DRYU_OPTIMIZE_SIZE Use smaller lookup tables. Instead of storing every
 //     required power of 5, only store every 26th entry, and compute
 //     intermediate values with a multiplication. This reduces the lookup table
 //     size by about 10x (only one case, and only double) at the cost of some
 //     performance. Currently requires MSVC intrinsics.
+//
+// -DRYU_HOT_TABLES Keep only the first 64 entries of the full lookup tables,
+//     which cover the common exponents (about 1e-48 to 1e79), and compute the
+//     others like RYU_OPTIMIZE_SIZE. This reduces the tables from about
+//     10 KB to 3 KB, with full table speed on typical data.
+//
+// -DRYU_LAZY_TABLES Cache the powers that RYU_OPTIMIZE_SIZE or RYU_HOT_TABLES
+//     compute, in a zero-initialized static table that is filled one range
+//     of 26 exponents at a time, on first use. Implies RYU_OPTIMIZE_SIZE if
+//     neither is set. The 10 KB of cache are not in the binary and only the
+//     pages of the ranges used are touched, and after warm-up conversions run
+//     at full table speed. Needs the GCC or Clang atomic builtins, and is
+//     ignored without them.
+//
+// -DRYU_SIMD Use SSE2 or NEON instructions to print mantissas of more than
+//     8 digits, instead of the DIGIT_TABLE loop. Ignored on other targets.
+//
+// -DRYU_STATS Count how often each conversion path is taken, per thread, for
+//     ryu_read_stats. Each count is a thread-local increment.
+//
+// -DRYU_PROFILE Time the decoding, d2d and printing stages of each
+//     conversion with the cycle counter, per thread and format, for
+//     ryu_read_profile and ryu_profile_dump. Uses rdtsc on x86 and cntvct_el0
+//     on AArch64, and counts no ticks on other targets. Each stage reads the
+//     counter twice, which slows conversions down noticeably.
+//
+// -DRYU_FREESTANDING Build without the C library, for kernels and bare-metal
+//     targets. Only the freestanding headers are included, the few string
+//     functions are replaced by local ones, and asserts are compiled out.
+//     ryu_string_many_parallel converts on the calling thread instead of
+//     allocating. Cannot be combined with RYU_DEBUG, RYU_STATS or
+//     RYU_PROFILE. Also compile with -ffreestanding, or at least
+//     -fno-tree-loop-distribute-patterns on GCC, as the optimizer otherwise
+//     turns the local loops back into memcpy, memset and strlen calls.
+//
+// Without RYU_STATS and RYU_PROFILE there is no global state other than the
+// RYU_LAZY_TABLES cache, which is filled lock-free, and every function is
+// reentrant and safe to call from any number of threads at once.
 
+#ifndef RYU_FREESTANDING
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#endif
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
-#include <string.h>
-#include <stdlib.h>
+#include <float.h>
+
+#ifdef RYU_FREESTANDING
+#if defined(RYU_DEBUG) || defined(RYU_STATS) || defined(RYU_PROFILE)
+#error "RYU_DEBUG needs stdio, RYU_STATS and RYU_PROFILE thread-locals"
+#endif
+
+#define assert(x) ((void) 0)
+
+static inline void* ryu_memcpy(void* dst, const void* src, size_t n) {
+    char* d = (char*) dst;
+    const char* s = (const char*) src;
+    while (n--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
+
+static inline void* ryu_memmove(void* dst, const void* src, size_t n) {
+    char* d = (char*) dst;
+    const char* s = (const char*) src;
+    if (d < s) {
+        while (n--) {
+            *d++ = *s++;
+        }
+    } else {
+        while (n--) {
+            d[n] = s[n];
+        }
+    }
+    return dst;
+}
+
+static inline void* ryu_memset(void* dst, int c, size_t n) {
+    char* d = (char*) dst;
+    while (n--) {
+        *d++ = (char) c;
+    }
+    return dst;
+}
+
+static inline int ryu_memcmp(const void* a, const void* b, size_t n) {
+    const unsigned char* x = (const unsigned char*) a;
+    const unsigned char* y = (const unsigned char*) b;
+    for (size_t i = 0; i < n; i++) {
+        if (x[i] != y[i]) {
+            return x[i] - y[i];
+        }
+    }
+    return 0;
+}
+
+static inline void* ryu_memchr(const void* src, int c, size_t n) {
+    const unsigned char* p = (const unsigned char*) src;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] == (unsigned char) c) {
+            return (void*) (p + i);
+        }
+    }
+    return NULL;
+}
+
+static inline size_t ryu_strlen(const char* s) {
+    size_t n = 0;
+    while (s[n]) {
+        n++;
+    }
+    return n;
+}
+
+static inline char* ryu_strchr(const char* s, int c) {
+    for (;; s++) {
+        if (*s == (char) c) {
+            return (char*) s;
+        }
+        if (!*s) {
+            return NULL;
+        }
+    }
+}
+
+// The copies of a constant size, which are most of them, stay inline
+// builtins that never become library calls.
+#if defined(__GNUC__)
+#define memcpy(d, s, n) (__builtin_constant_p(n) ? \
+    __builtin_memcpy((d), (s), (n)) : ryu_memcpy((d), (s), (n)))
+#else
+#define memcpy ryu_memcpy
+#endif
+#define memmove ryu_memmove
+#define memset ryu_memset
+#define memcmp ryu_memcmp
+#define memchr ryu_memchr
+#define strlen ryu_strlen
+#define strchr ryu_strchr
+#endif
 
 #ifdef RYU_STATIC
 #define RYU_EXTERN static
@@ -60,10 +202,184 @@
 #include <stdio.h>
 #endif
 
-#if defined(_M_IX86) || defined(_M_ARM)
+// GCC and Clang on 32-bit x86 and ARMv7 also need the 32-bit division
+// helpers, or every 64-bit division becomes a __udivdi3 or __aeabi_uldivmod
+// library call.
+#if defined(_M_IX86) || defined(_M_ARM) || \
+    (defined(__GNUC__) && (defined(__i386__) || defined(__arm__)))
 #define RYU_32_BIT_PLATFORM
 #endif
 
+#ifndef RYU_STATS_DEFINED
+#define RYU_STATS_DEFINED
+// Counts of the conversion paths taken by one thread.
+struct ryu_stats {
+    uint64_t special;        // NaN and infinities
+    uint64_t zero;           // positive and negative zero
+    uint64_t small_int;      // integers below 2^53, without d2d
+    uint64_t general;        // d2d, and f2d for floats
+    uint64_t trailing_zeros; // the rare d2d and f2d trailing zeros case
+    uint64_t fixed;          // 'g' and 'j' outputs without an exponent
+    uint64_t exponent;       // 'g' and 'j' outputs with an exponent
+};
+#endif
+
+#ifdef RYU_STATS
+#if defined(_MSC_VER)
+static __declspec(thread) struct ryu_stats thread_stats;
+#else
+static _Thread_local struct ryu_stats thread_stats;
+#endif
+#define RYU_STAT_ADD(name, n) (thread_stats.name += (n))
+#else
+#define RYU_STAT_ADD(name, n) ((void) 0)
+#endif
+#define RYU_STAT(name) RYU_STAT_ADD(name, 1)
+
+#ifndef RYU_PROFILE_DEFINED
+#define RYU_PROFILE_DEFINED
+// The stages timed by RYU_PROFILE.
+#define RYU_PROFILE_DECODE 0 // the bits to a decimal, without d2d
+#define RYU_PROFILE_D2D 1    // d2d, the shortest digits and their exponent
+#define RYU_PROFILE_PRINT 2  // print_options, the digits and the form
+#define RYU_PROFILE_TOTAL 3  // a whole ryu_string or ryu_write_double call
+#define RYU_PROFILE_REST 4   // the ticks of each total outside of the stages
+#define RYU_PROFILE_STAGES 5
+// The formats "eEfgGjJ", and then every other entry point.
+#define RYU_PROFILE_FORMATS 8
+#define RYU_PROFILE_BUCKETS 16
+// The ticks of one stage in one format.
+struct ryu_profile_stage {
+    uint64_t count;
+    uint64_t ticks;
+    // Bucket 0 counts the calls that took no ticks, bucket i those that took
+    // from 2^(i-1) to 2^i - 1, and the last bucket every longer call.
+    uint64_t histogram[RYU_PROFILE_BUCKETS];
+};
+struct ryu_profile {
+    struct ryu_profile_stage stages[RYU_PROFILE_FORMATS][RYU_PROFILE_STAGES];
+};
+#endif
+
+#ifdef RYU_PROFILE
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// The timings of the thread, the format of its current conversion, and the
+// stage ticks since that conversion began.
+#if defined(_MSC_VER)
+static __declspec(thread) struct ryu_profile thread_profile;
+static __declspec(thread) uint32_t thread_profile_format = 
+    RYU_PROFILE_FORMATS - 1;
+static __declspec(thread) uint64_t thread_profile_inner;
+#else
+static _Thread_local struct ryu_profile thread_profile;
+static _Thread_local uint32_t thread_profile_format = RYU_PROFILE_FORMATS - 1;
+static _Thread_local uint64_t thread_profile_inner;
+#endif
+
+// Reads the time stamp counter on x86 and the virtual counter on AArch64,
+// which usually runs at a fixed rate well below the clock. Other targets
+// count no ticks.
+static inline uint64_t profile_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__) && defined(__GNUC__)
+    uint64_t t;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#elif defined(_M_ARM64)
+    return (uint64_t) _ReadStatusReg(ARM64_CNTVCT);
+#else
+    return 0;
+#endif
+}
+
+static inline uint32_t profile_bucket(uint64_t ticks) {
+    uint32_t b = 0;
+#if defined(__GNUC__)
+    if (ticks != 0) {
+        b = 64 - (uint32_t) __builtin_clzll(ticks);
+    }
+#else
+    while (ticks != 0) {
+        b++;
+        ticks >>= 1;
+    }
+#endif
+    return b < RYU_PROFILE_BUCKETS ? b : RYU_PROFILE_BUCKETS - 1;
+}
+
+static inline void profile_record(const uint32_t stage, 
+    const uint64_t ticks)
+{
+    struct ryu_profile_stage* s = 
+        &thread_profile.stages[thread_profile_format][stage];
+    s->count++;
+    s->ticks += ticks;
+    s->histogram[profile_bucket(ticks)]++;
+}
+
+// Records the ticks since start for stage, in the current format, and
+// returns them.
+static inline uint64_t profile_end(const uint32_t stage, const uint64_t start) 
+{
+    const uint64_t ticks = profile_ticks() - start;
+    profile_record(stage, ticks);
+    thread_profile_inner += ticks;
+    return ticks;
+}
+
+// Records the total since start, and the part of it outside of the stages
+// that ended since then, and returns to the "other" format.
+static inline void profile_exit(const uint64_t start) {
+    const uint64_t ticks = profile_ticks() - start;
+    const uint64_t inner = thread_profile_inner;
+    profile_record(RYU_PROFILE_TOTAL, ticks);
+    profile_record(RYU_PROFILE_REST, ticks > inner ? ticks - inner : 0);
+    thread_profile_format = RYU_PROFILE_FORMATS - 1;
+}
+
+// The index of a format in ryu_profile, from the flags of print_format.
+static inline uint32_t profile_format(const bool f, const bool g, 
+    const bool j, const char ech)
+{
+    const uint32_t upper = ech == 'E';
+    return !f ? upper : !g ? 2 : (j ? 5 : 3) + upper;
+}
+
+#define RYU_PROFILE_BEGIN(name) uint64_t name = profile_ticks()
+#define RYU_PROFILE_END(stage, name) ((void) profile_end((stage), (name)))
+// Ends stage, and moves the start of the enclosing stage past it.
+#define RYU_PROFILE_NESTED(stage, name, outer) \
+    ((outer) += profile_end((stage), (name)))
+#define RYU_PROFILE_FORMAT(f, g, j, ech) \
+    (thread_profile_format = profile_format((f), (g), (j), (ech)), \
+    thread_profile_inner = 0)
+#define RYU_PROFILE_FORMAT_END() \
+    (thread_profile_format = RYU_PROFILE_FORMATS - 1)
+// Ends the total of a conversion that began with RYU_PROFILE_FORMAT.
+#define RYU_PROFILE_EXIT(name) profile_exit(name)
+#else
+#define RYU_PROFILE_BEGIN(name) ((void) 0)
+#define RYU_PROFILE_END(stage, name) ((void) 0)
+#define RYU_PROFILE_NESTED(stage, name, outer) ((void) 0)
+#define RYU_PROFILE_FORMAT(f, g, j, ech) ((void) 0)
+#define RYU_PROFILE_FORMAT_END() ((void) 0)
+#define RYU_PROFILE_EXIT(name) ((void) 0)
+#endif
+
+#if defined(RYU_LAZY_TABLES) && defined(__GNUC__)
+#define HAS_LAZY_TABLES
+#if !defined(RYU_OPTIMIZE_SIZE) && !defined(RYU_HOT_TABLES)
+#define RYU_OPTIMIZE_SIZE
+#endif
+#endif
+
 // Returns e == 0 ? 1 : ceil(log_2(5^e)); requires 0 <= e <= 3528.
 static inline int32_t pow5bits(const int32_t e) {
     // This approximation works up to the point that the multiplication
@@ -141,15 +457,61 @@ static const char DIGIT_TABLE[200] = {
 #if defined(__SIZEOF_INT128__) && !defined(_MSC_VER) && \
     !defined(RYU_ONLY_64_BIT_OPS)
 #define HAS_UINT128
-#elif defined(_MSC_VER) && !defined(RYU_ONLY_64_BIT_OPS) && defined(_M_X64)
+#elif defined(_MSC_VER) && !defined(RYU_ONLY_64_BIT_OPS) && \
+    (defined(_M_X64) || defined(_M_ARM64))
 #define HAS_64_BIT_INTRINSICS
 #endif
 
+// On AArch64 the low and high halves of a 64x64-bit product are separate mul
+// and umulh instructions, so the mulShiftAll64 that shares two products
+// between vr, vp and vm should beat three independent mulShift64 calls,
+// which need six.
+#ifdef RYU_SHARED_MUL_SHIFT
+#define HAS_SHARED_MUL_SHIFT
+#endif
+
 #if defined(HAS_UINT128)
 typedef __uint128_t uint128_t;
 #endif
 
-#if defined(HAS_64_BIT_INTRINSICS)
+#if defined(HAS_UINT128)
+
+static inline uint64_t umul128(const uint64_t a, const uint64_t b, uint64_t*
+    const productHi)
+{
+    const uint128_t p = (uint128_t) a * b;
+    *productHi = (uint64_t) (p >> 64);
+    return (uint64_t) p;
+}
+
+static inline uint64_t shiftright128(const uint64_t lo, const uint64_t hi,
+    const uint32_t dist)
+{
+    assert(dist < 64);
+    assert(dist > 0);
+    return (hi << (64 - dist)) | (lo >> dist);
+}
+
+#elif defined(HAS_64_BIT_INTRINSICS) && defined(_M_ARM64)
+
+#include <intrin.h>
+
+static inline uint64_t umul128(const uint64_t a, const uint64_t b, uint64_t*
+    const productHi)
+{
+    *productHi = __umulh(a, b);
+    return a * b;
+}
+
+static inline uint64_t shiftright128(const uint64_t lo, const uint64_t hi,
+    const uint32_t dist)
+{
+    assert(dist < 64);
+    assert(dist > 0);
+    return (hi << (64 - dist)) | (lo >> dist);
+}
+
+#elif defined(HAS_64_BIT_INTRINSICS)
 
 #include <intrin.h>
 
@@ -177,7 +539,7 @@ static inline uint64_t shiftright128(const uint64_t lo, const uint64_t hi,
     return __shiftright128(lo, hi, (unsigned char) dist);
 }
 
-#else // defined(HAS_64_BIT_INTRINSICS)
+#else // !defined(HAS_UINT128) && !defined(HAS_64_BIT_INTRINSICS)
 
 static inline uint64_t umul128(const uint64_t a, const uint64_t b, uint64_t*
     const productHi)
@@ -220,7 +582,7 @@ static inline uint64_t shiftright128(const uint64_t lo, const uint64_t hi,
     return (hi << (64 - dist)) | (lo >> dist);
 }
 
-#endif // defined(HAS_64_BIT_INTRINSICS)
+#endif // defined(HAS_UINT128)
 
 #if defined(RYU_32_BIT_PLATFORM)
 
@@ -375,7 +737,11 @@ static inline bool multipleOfPowerOf2(const uint64_t value, const uint32_t p) {
 //    c. Split only the first factor into 31-bit pieces, which also guarantees
 //       no internal overflow, but requires extra work since the intermediate
 //       results are not perfectly aligned.
-#if defined(HAS_UINT128)
+//
+// With RYU_SHARED_MUL_SHIFT, for targets where the two halves of a product
+// cost an instruction each, as with mul and umulh on AArch64, the
+// mulShiftAll64 of case 3 is used on top of the native multiplication.
+#if defined(HAS_UINT128) && !defined(HAS_SHARED_MUL_SHIFT)
 
 // Best case: use 128-bit type.
 static inline uint64_t mulShift64(const uint64_t m, const uint64_t* const mul, 
@@ -395,7 +761,7 @@ static inline uint64_t mulShiftAll64(const uint64_t m, const uint64_t*
     return mulShift64(4 * m, mul, j);
 }
 
-#elif defined(HAS_64_BIT_INTRINSICS)
+#elif defined(HAS_64_BIT_INTRINSICS) && !defined(HAS_SHARED_MUL_SHIFT)
 
 static inline uint64_t mulShift64(const uint64_t m, const uint64_t* const mul, 
     const int32_t j) 
@@ -421,7 +787,22 @@ static inline uint64_t mulShiftAll64(const uint64_t m, const uint64_t*
     return mulShift64(4 * m, mul, j);
 }
 
-#else // !defined(HAS_UINT128) && !defined(HAS_64_BIT_INTRINSICS)
+#else // no 64x64->128-bit multiplication, or HAS_SHARED_MUL_SHIFT
+
+static inline uint64_t mulShift64(const uint64_t m, const uint64_t* const mul, 
+    const int32_t j) 
+{
+    // m is maximum 55 bits
+    uint64_t high1;                                   // 128
+    const uint64_t low1 = umul128(m, mul[1], &high1); // 64
+    uint64_t high0;                                   // 64
+    umul128(m, mul[0], &high0);                       // 0
+    const uint64_t sum = high0 + low1;
+    if (sum < high0) {
+        ++high1; // overflow into high1
+    }
+    return shiftright128(sum, high1, j - 64);
+}
 
 // This is faster if we don't have a 64x64->128-bit multiplication.
 static inline uint64_t mulShiftAll64(uint64_t m, const uint64_t* const mul, 
@@ -462,7 +843,9 @@ static inline uint64_t mulShiftAll64(uint64_t m, const uint64_t* const mul,
 #endif // HAS_64_BIT_INTRINSICS
 
 // Include either the small or the full lookup tables depending on the mode.
-#if defined(RYU_OPTIMIZE_SIZE)
+// RYU_HOT_TABLES uses both: the first DOUBLE_POW5_HOT_SIZE entries of the
+// full tables, and the small tables to compute the rest.
+#if defined(RYU_OPTIMIZE_SIZE) || defined(RYU_HOT_TABLES)
 
 // These tables are generated by PrintDoubleLookupTable.
 #define DOUBLE_POW5_INV_BITCOUNT 125
@@ -633,13 +1016,23 @@ static inline void double_computeInvPow5(const uint32_t i,
 
 #endif // defined(HAS_UINT128)
 
-#else
+#endif // RYU_OPTIMIZE_SIZE || RYU_HOT_TABLES
+
+#if !defined(RYU_OPTIMIZE_SIZE)
 // These tables are generated by PrintDoubleLookupTable.
 #define DOUBLE_POW5_INV_BITCOUNT 125
 #define DOUBLE_POW5_BITCOUNT 125
 
+#if defined(RYU_HOT_TABLES)
+// The hot entries cover 2^-160 to 2^265 in d2d, and decimal exponents
+// from -63 to 63 in s2d.
+#define DOUBLE_POW5_HOT_SIZE 64
+#define DOUBLE_POW5_INV_TABLE_SIZE DOUBLE_POW5_HOT_SIZE
+#define DOUBLE_POW5_TABLE_SIZE DOUBLE_POW5_HOT_SIZE
+#else
 #define DOUBLE_POW5_INV_TABLE_SIZE 342
 #define DOUBLE_POW5_TABLE_SIZE 326
+#endif
 
 static const uint64_t DOUBLE_POW5_INV_SPLIT[DOUBLE_POW5_INV_TABLE_SIZE][2] = {
     {                    1u, 2305843009213693952u }, 
@@ -706,6 +1099,7 @@ static const uint64_t DOUBLE_POW5_INV_SPLIT[DOUBLE_POW5_INV_TABLE_SIZE][2] = {
     {  7779150767507678651u, 1482138742237647301u },
     {  2533971799264232598u, 1185710993790117841u },
     { 15122401323048503126u, 1897137590064188545u },
+#if !defined(RYU_HOT_TABLES)
     { 12097921058438802501u, 1517710072051350836u },
     {  5988988032009131678u, 1214168057641080669u },
     { 16961078480698431330u, 1942668892225729070u },
@@ -984,6 +1378,7 @@ static const uint64_t DOUBLE_POW5_INV_SPLIT[DOUBLE_POW5_INV_TABLE_SIZE][2] = {
     {  9122891541139893884u, 2101865168015838698u },
     { 14677010862395735754u, 1681492134412670958u },
     {   673562245690857633u, 1345193707530136767u }
+#endif // !RYU_HOT_TABLES
 };
 
 static const uint64_t DOUBLE_POW5_SPLIT[DOUBLE_POW5_TABLE_SIZE][2] = {
@@ -1051,6 +1446,7 @@ static const uint64_t DOUBLE_POW5_SPLIT[DOUBLE_POW5_TABLE_SIZE][2] = {
     { 14432250487333400542u, 1793662034335765850u },
     {  8816941072311974870u, 2242077542919707313u }, 
     { 17039803216263454053u, 1401298464324817070u },
+#if !defined(RYU_HOT_TABLES)
     { 12076381983474541759u, 1751623080406021338u }, 
     {  5872105442488401391u, 2189528850507526673u },
     { 15199280947623720629u, 1368455531567204170u }, 
@@ -1313,8 +1709,121 @@ static const uint64_t DOUBLE_POW5_SPLIT[DOUBLE_POW5_TABLE_SIZE][2] = {
     {  5246222702107417334u, 2278475631111374216u },
     {  3278889188817135834u, 1424047269444608885u }, 
     {  8710297504448807696u, 1780059086805761106u }
+#endif // !RYU_HOT_TABLES
 };
 
+#endif // !RYU_OPTIMIZE_SIZE
+
+#if defined(RYU_OPTIMIZE_SIZE) || defined(RYU_HOT_TABLES)
+
+#if defined(HAS_LAZY_TABLES)
+// The number of powers that d2d and s2d look up, like the full tables.
+#define LAZY_POW5_SIZE 326
+#define LAZY_POW5_INV_SIZE 342
+
+// The state of one range of the cache. The thread that moves a range from
+// empty to filling computes all of its entries and then publishes it as
+// ready. Until then, the other threads compute the powers they need without
+// waiting, so that no entry is ever written by two threads.
+#define LAZY_EMPTY 0
+#define LAZY_FILLING 1
+#define LAZY_READY 2
+
+// Range b of the cache holds 5^i for i / 26 == b, and 5^-i for
+// (i + 25) / 26 == b, the powers computed from the same base.
+static uint64_t LAZY_POW5[LAZY_POW5_SIZE][2];
+static uint64_t LAZY_POW5_INV[LAZY_POW5_INV_SIZE][2];
+static uint8_t LAZY_POW5_STATE[(LAZY_POW5_SIZE - 1) / POW5_TABLE_SIZE + 1];
+static uint8_t LAZY_POW5_INV_STATE[(LAZY_POW5_INV_SIZE + POW5_TABLE_SIZE - 2) / 
+    POW5_TABLE_SIZE + 1];
+
+static inline bool lazy_ready(uint8_t* const state) {
+    return __atomic_load_n(state, __ATOMIC_ACQUIRE) == LAZY_READY;
+}
+
+static inline bool lazy_claim(uint8_t* const state) {
+    uint8_t expected = LAZY_EMPTY;
+    return __atomic_compare_exchange_n(state, &expected, LAZY_FILLING, false,
+        __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static inline void lazy_publish(uint8_t* const state) {
+    __atomic_store_n(state, LAZY_READY, __ATOMIC_RELEASE);
+}
+
+// Fills range b of the cache of 5^i.
+static void lazy_fill_pow5(const uint32_t b) {
+    const uint32_t end = b * POW5_TABLE_SIZE + POW5_TABLE_SIZE;
+    for (uint32_t i = b * POW5_TABLE_SIZE; 
+        i < end && i < LAZY_POW5_SIZE; i++) 
+    {
+        double_computePow5(i, LAZY_POW5[i]);
+    }
+    lazy_publish(&LAZY_POW5_STATE[b]);
+}
+
+// Fills range b of the cache of 5^-i.
+static void lazy_fill_invPow5(const uint32_t b) {
+    const uint32_t end = b * POW5_TABLE_SIZE;
+    for (uint32_t i = b > 0 ? end - POW5_TABLE_SIZE + 1 : 0; 
+        i <= end && i < LAZY_POW5_INV_SIZE; i++) 
+    {
+        double_computeInvPow5(i, LAZY_POW5_INV[i]);
+    }
+    lazy_publish(&LAZY_POW5_INV_STATE[b]);
+}
+#endif
+
+// Returns 5^i in the form required by Ryu, from the hot table or the cache
+// if either has it, or computed into result.
+static inline const uint64_t* double_pow5(const uint32_t i, 
+    uint64_t* const result)
+{
+#if defined(RYU_HOT_TABLES) && !defined(RYU_OPTIMIZE_SIZE)
+    if (i < DOUBLE_POW5_HOT_SIZE) {
+        return DOUBLE_POW5_SPLIT[i];
+    }
+#endif
+#if defined(HAS_LAZY_TABLES)
+    if (i < LAZY_POW5_SIZE) {
+        const uint32_t b = i / POW5_TABLE_SIZE;
+        if (lazy_ready(&LAZY_POW5_STATE[b])) {
+            return LAZY_POW5[i];
+        }
+        if (lazy_claim(&LAZY_POW5_STATE[b])) {
+            lazy_fill_pow5(b);
+            return LAZY_POW5[i];
+        }
+    }
+#endif
+    double_computePow5(i, result);
+    return result;
+}
+
+// Returns 5^-i in the form required by Ryu, like double_pow5.
+static inline const uint64_t* double_invPow5(const uint32_t i, 
+    uint64_t* const result)
+{
+#if defined(RYU_HOT_TABLES) && !defined(RYU_OPTIMIZE_SIZE)
+    if (i < DOUBLE_POW5_HOT_SIZE) {
+        return DOUBLE_POW5_INV_SPLIT[i];
+    }
+#endif
+#if defined(HAS_LAZY_TABLES)
+    if (i < LAZY_POW5_INV_SIZE) {
+        const uint32_t b = (i + POW5_TABLE_SIZE - 1) / POW5_TABLE_SIZE;
+        if (lazy_ready(&LAZY_POW5_INV_STATE[b])) {
+            return LAZY_POW5_INV[i];
+        }
+        if (lazy_claim(&LAZY_POW5_INV_STATE[b])) {
+            lazy_fill_invPow5(b);
+            return LAZY_POW5_INV[i];
+        }
+    }
+#endif
+    double_computeInvPow5(i, result);
+    return result;
+}
 #endif
 
 #define DOUBLE_MANTISSA_BITS 52
@@ -1395,10 +1904,9 @@ static inline floating_decimal_64 d2d(const uint64_t ieeeMantissa,
         e10 = (int32_t) q;
         const int32_t k = DOUBLE_POW5_INV_BITCOUNT + pow5bits((int32_t) q) - 1;
         const int32_t i = -e2 + (int32_t) q + k;
-#if defined(RYU_OPTIMIZE_SIZE)
+#if defined(RYU_OPTIMIZE_SIZE) || defined(RYU_HOT_TABLES)
         uint64_t pow5[2];
-        double_computeInvPow5(q, pow5);
-        vr = mulShiftAll64(m2, pow5, i, &vp, &vm, mmShift);
+        vr = mulShiftAll64(m2, double_invPow5(q, pow5), i, &vp, &vm, mmShift);
 #else
         vr = mulShiftAll64(m2, DOUBLE_POW5_INV_SPLIT[q], i, &vp, &vm, mmShift);
 #endif
@@ -1431,10 +1939,10 @@ static inline floating_decimal_64 d2d(const uint64_t ieeeMantissa,
         const int32_t i = -e2 - (int32_t) q;
         const int32_t k = pow5bits(i) - DOUBLE_POW5_BITCOUNT;
         const int32_t j = (int32_t) q - k;
-#if defined(RYU_OPTIMIZE_SIZE)
+#if defined(RYU_OPTIMIZE_SIZE) || defined(RYU_HOT_TABLES)
         uint64_t pow5[2];
-        double_computePow5(i, pow5);
-        vr = mulShiftAll64(m2, pow5, j, &vp, &vm, mmShift);
+        vr = mulShiftAll64(m2, double_pow5((uint32_t) i, pow5), j, &vp, &vm, 
+            mmShift);
 #else
         vr = mulShiftAll64(m2, DOUBLE_POW5_SPLIT[i], j, &vp, &vm, mmShift);
 #endif
@@ -1484,6 +1992,7 @@ static inline floating_decimal_64 d2d(const uint64_t ieeeMantissa,
       // On average, we remove ~2 digits.
       if (vmIsTrailingZeros || vrIsTrailingZeros) {
           // General case, which happens rarely (~0.7%).
+          RYU_STAT(trailing_zeros);
           for (;;) {
               const uint64_t vpDiv10 = div10(vp);
               const uint64_t vmDiv10 = div10(vm);
@@ -1597,31 +2106,112 @@ static inline floating_decimal_64 d2d(const uint64_t ieeeMantissa,
     return fd;
 }
 
-static inline int to_chars(const floating_decimal_64 v, const bool sign, 
+#if defined(RYU_SIMD) && (defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define HAS_SSE2
+#elif defined(RYU_SIMD) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define HAS_NEON
+#endif
+
+#if defined(HAS_SSE2)
+
+#include <emmintrin.h>
+
+// Prints hi and lo, both less than 10^8, as 16 digits to result. Every
+// 4-digit group is divided by 10^3, 10^2, 10^1 and 10^0 in parallel using
+// 16-bit multiply-shifts, and the remainders come from subtracting ten
+// times the neighboring lane.
+static inline void write_digits16(const uint32_t hi, const uint32_t lo,
     char* const result)
 {
-    // Step 5: Print the decimal representation.
-    int index = 0;
-    if (sign) {
-        result[index++] = '-';
+    const __m128i div = _mm_setr_epi16(8389, 5243, 13108, -32768, 
+        8389, 5243, 13108, -32768);
+    const __m128i shift = _mm_setr_epi16(1 << 7, 1 << 11, 1 << 13, -32768, 
+        1 << 7, 1 << 11, 1 << 13, -32768);
+    const __m128i ten = _mm_set1_epi16(10);
+    __m128i v[2];
+    for (int i = 0; i < 2; i++) {
+        const uint32_t x = i == 0 ? hi : lo;
+        const short abcd = (short) ((x / 10000) << 2);
+        const short efgh = (short) ((x % 10000) << 2);
+        const __m128i x4 = _mm_setr_epi16(abcd, abcd, abcd, abcd, 
+            efgh, efgh, efgh, efgh);
+        // [ a, ab, abc, abcd, e, ef, efg, efgh ]
+        const __m128i q = _mm_mulhi_epu16(_mm_mulhi_epu16(x4, div), shift);
+        // [ a, b, c, d, e, f, g, h ]
+        v[i] = _mm_sub_epi16(q, _mm_slli_epi64(_mm_mullo_epi16(q, ten), 16));
     }
+    const __m128i digits = _mm_add_epi8(_mm_packus_epi16(v[0], v[1]),
+        _mm_set1_epi8('0'));
+    _mm_storeu_si128((__m128i*) result, digits);
+}
 
-    uint64_t output = v.mantissa;
-    const uint32_t olength = decimalLength17(output);
+#elif defined(HAS_NEON)
 
-#ifdef RYU_DEBUG
-    printf("DIGITS=%" PRIu64 "\n", v.mantissa);
-    printf("OLEN=%u\n", olength);
-    printf("EXP=%u\n", v.exponent + olength);
+#if defined(_M_ARM64)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
 #endif
 
-    // Print the decimal digits.
+// Converts x, less than 10^4, to 4 lanes of [ a, b, c, d ] by dividing by
+// 10^3, 10^2, 10^1 and 10^0 in parallel with 32-bit multiply-shifts, and
+// subtracting ten times the neighboring lane.
+static inline uint32x4_t digits4_neon(const uint32_t x) {
+    static const uint32_t mul[4] = { 8389, 5243, 13108, 1 };
+    static const int32_t shift[4] = { -23, -19, -17, 0 };
+    // [ a, ab, abc, abcd ]
+    const uint32x4_t q = vshlq_u32(vmulq_u32(vdupq_n_u32(x), vld1q_u32(mul)),
+        vld1q_s32(shift));
+    return vmlsq_n_u32(q, vextq_u32(vdupq_n_u32(0), q, 3), 10);
+}
+
+// Prints hi and lo, both less than 10^8, as 16 digits to result.
+static inline void write_digits16(const uint32_t hi, const uint32_t lo,
+    char* const result)
+{
+    const uint16x8_t h = vcombine_u16(vmovn_u32(digits4_neon(hi / 10000)),
+        vmovn_u32(digits4_neon(hi % 10000)));
+    const uint16x8_t l = vcombine_u16(vmovn_u32(digits4_neon(lo / 10000)),
+        vmovn_u32(digits4_neon(lo % 10000)));
+    const uint8x16_t digits = vaddq_u8(vcombine_u8(vmovn_u16(h), 
+        vmovn_u16(l)), vdupq_n_u8('0'));
+    vst1q_u8((uint8_t*) result, digits);
+}
+
+#endif // HAS_NEON
+
+// Writes the olength decimal digits of output to result[0..olength-1].
+static inline void write_digits(uint64_t output, const uint32_t olength, 
+    char* const result)
+{
     // The following code is equivalent to:
     // for (uint32_t i = 0; i < olength - 1; ++i) {
     //   const uint32_t c = output % 10; output /= 10;
-    //   result[index + olength - i] = (char) ('0' + c);
+    //   result[olength - i - 1] = (char) ('0' + c);
     // }
-    // result[index] = '0' + output % 10;
+    // result[0] = '0' + output % 10;
+
+#if defined(HAS_SSE2) || defined(HAS_NEON)
+    if (olength > 8) {
+        const uint64_t q = div1e8(output);
+        const uint32_t lo = ((uint32_t) output) - 100000000 * ((uint32_t) q);
+        uint32_t hi = (uint32_t) q;
+        uint32_t n = olength;
+        char* r = result;
+        if (n == 17) {
+            // The 17th digit doesn't fit into the vector.
+            const uint32_t c = hi / 100000000;
+            hi -= 100000000 * c;
+            *r++ = (char) ('0' + c);
+            --n;
+        }
+        char digits[16];
+        write_digits16(hi, lo, digits);
+        memcpy(r, digits + 16 - n, n);
+        return;
+    }
+#endif
 
     uint32_t i = 0;
     // We prefer 32-bit operations, even on 64-bit platforms.
@@ -1641,10 +2231,10 @@ static inline int to_chars(const floating_decimal_64 v, const bool sign,
         const uint32_t c1 = (c / 100) << 1;
         const uint32_t d0 = (d % 100) << 1;
         const uint32_t d1 = (d / 100) << 1;
-        memcpy(result + index + olength - i - 1, DIGIT_TABLE + c0, 2);
-        memcpy(result + index + olength - i - 3, DIGIT_TABLE + c1, 2);
-        memcpy(result + index + olength - i - 5, DIGIT_TABLE + d0, 2);
-        memcpy(result + index + olength - i - 7, DIGIT_TABLE + d1, 2);
+        memcpy(result + olength - i - 2, DIGIT_TABLE + c0, 2);
+        memcpy(result + olength - i - 4, DIGIT_TABLE + c1, 2);
+        memcpy(result + olength - i - 6, DIGIT_TABLE + d0, 2);
+        memcpy(result + olength - i - 8, DIGIT_TABLE + d1, 2);
         i += 8;
     }
     uint32_t output2 = (uint32_t) output;
@@ -1657,58 +2247,281 @@ static inline int to_chars(const floating_decimal_64 v, const bool sign,
         output2 /= 10000;
         const uint32_t c0 = (c % 100) << 1;
         const uint32_t c1 = (c / 100) << 1;
-        memcpy(result + index + olength - i - 1, DIGIT_TABLE + c0, 2);
-        memcpy(result + index + olength - i - 3, DIGIT_TABLE + c1, 2);
+        memcpy(result + olength - i - 2, DIGIT_TABLE + c0, 2);
+        memcpy(result + olength - i - 4, DIGIT_TABLE + c1, 2);
         i += 4;
     }
     if (output2 >= 100) {
         const uint32_t c = (output2 % 100) << 1;
         output2 /= 100;
-        memcpy(result + index + olength - i - 1, DIGIT_TABLE + c, 2);
+        memcpy(result + olength - i - 2, DIGIT_TABLE + c, 2);
         i += 2;
     }
     if (output2 >= 10) {
         const uint32_t c = output2 << 1;
-        // We can't use memcpy here: the decimal dot goes between these two 
-        // digits.
-        result[index + olength - i] = DIGIT_TABLE[c + 1];
-        result[index] = DIGIT_TABLE[c];
+        memcpy(result, DIGIT_TABLE + c, 2);
     } else {
-        result[index] = (char) ('0' + output2);
+        result[0] = (char) ('0' + output2);
     }
+}
 
-    // Print decimal point if needed.
-    if (olength > 1) {
-        result[index + 1] = '.';
-        index += olength + 1;
-    } else {
-        ++index;
+#define EXPONENT_MIN -324
+#define EXPONENT_MAX 308
+
+// The signed exponents -324 to 308, right-aligned in 4 bytes. The suffix of
+// an exponent is written with a single 4-byte store that ends where the
+// output ends, and the digits before it are printed over the padding. Without
+// the '+', a non-negative exponent is the same suffix one byte shorter.
+static const char EXPONENT_TABLE[EXPONENT_MAX - EXPONENT_MIN + 1][4] = {
+    "-324", "-323", "-322", "-321", "-320", "-319", "-318", "-317", "-316",
+    "-315", "-314", "-313", "-312", "-311", "-310", "-309", "-308", "-307",
+    "-306", "-305", "-304", "-303", "-302", "-301", "-300", "-299", "-298",
+    "-297", "-296", "-295", "-294", "-293", "-292", "-291", "-290", "-289",
+    "-288", "-287", "-286", "-285", "-284", "-283", "-282", "-281", "-280",
+    "-279", "-278", "-277", "-276", "-275", "-274", "-273", "-272", "-271",
+    "-270", "-269", "-268", "-267", "-266", "-265", "-264", "-263", "-262",
+    "-261", "-260", "-259", "-258", "-257", "-256", "-255", "-254", "-253",
+    "-252", "-251", "-250", "-249", "-248", "-247", "-246", "-245", "-244",
+    "-243", "-242", "-241", "-240", "-239", "-238", "-237", "-236", "-235",
+    "-234", "-233", "-232", "-231", "-230", "-229", "-228", "-227", "-226",
+    "-225", "-224", "-223", "-222", "-221", "-220", "-219", "-218", "-217",
+    "-216", "-215", "-214", "-213", "-212", "-211", "-210", "-209", "-208",
+    "-207", "-206", "-205", "-204", "-203", "-202", "-201", "-200", "-199",
+    "-198", "-197", "-196", "-195", "-194", "-193", "-192", "-191", "-190",
+    "-189", "-188", "-187", "-186", "-185", "-184", "-183", "-182", "-181",
+    "-180", "-179", "-178", "-177", "-176", "-175", "-174", "-173", "-172",
+    "-171", "-170", "-169", "-168", "-167", "-166", "-165", "-164", "-163",
+    "-162", "-161", "-160", "-159", "-158", "-157", "-156", "-155", "-154",
+    "-153", "-152", "-151", "-150", "-149", "-148", "-147", "-146", "-145",
+    "-144", "-143", "-142", "-141", "-140", "-139", "-138", "-137", "-136",
+    "-135", "-134", "-133", "-132", "-131", "-130", "-129", "-128", "-127",
+    "-126", "-125", "-124", "-123", "-122", "-121", "-120", "-119", "-118",
+    "-117", "-116", "-115", "-114", "-113", "-112", "-111", "-110", "-109",
+    "-108", "-107", "-106", "-105", "-104", "-103", "-102", "-101", "-100",
+    " -99", " -98", " -97", " -96", " -95", " -94", " -93", " -92", " -91",
+    " -90", " -89", " -88", " -87", " -86", " -85", " -84", " -83", " -82",
+    " -81", " -80", " -79", " -78", " -77", " -76", " -75", " -74", " -73",
+    " -72", " -71", " -70", " -69", " -68", " -67", " -66", " -65", " -64",
+    " -63", " -62", " -61", " -60", " -59", " -58", " -57", " -56", " -55",
+    " -54", " -53", " -52", " -51", " -50", " -49", " -48", " -47", " -46",
+    " -45", " -44", " -43", " -42", " -41", " -40", " -39", " -38", " -37",
+    " -36", " -35", " -34", " -33", " -32", " -31", " -30", " -29", " -28",
+    " -27", " -26", " -25", " -24", " -23", " -22", " -21", " -20", " -19",
+    " -18", " -17", " -16", " -15", " -14", " -13", " -12", " -11", " -10",
+    "  -9", "  -8", "  -7", "  -6", "  -5", "  -4", "  -3", "  -2", "  -1",
+    "  +0", "  +1", "  +2", "  +3", "  +4", "  +5", "  +6", "  +7", "  +8",
+    "  +9", " +10", " +11", " +12", " +13", " +14", " +15", " +16", " +17",
+    " +18", " +19", " +20", " +21", " +22", " +23", " +24", " +25", " +26",
+    " +27", " +28", " +29", " +30", " +31", " +32", " +33", " +34", " +35",
+    " +36", " +37", " +38", " +39", " +40", " +41", " +42", " +43", " +44",
+    " +45", " +46", " +47", " +48", " +49", " +50", " +51", " +52", " +53",
+    " +54", " +55", " +56", " +57", " +58", " +59", " +60", " +61", " +62",
+    " +63", " +64", " +65", " +66", " +67", " +68", " +69", " +70", " +71",
+    " +72", " +73", " +74", " +75", " +76", " +77", " +78", " +79", " +80",
+    " +81", " +82", " +83", " +84", " +85", " +86", " +87", " +88", " +89",
+    " +90", " +91", " +92", " +93", " +94", " +95", " +96", " +97", " +98",
+    " +99", "+100", "+101", "+102", "+103", "+104", "+105", "+106", "+107",
+    "+108", "+109", "+110", "+111", "+112", "+113", "+114", "+115", "+116",
+    "+117", "+118", "+119", "+120", "+121", "+122", "+123", "+124", "+125",
+    "+126", "+127", "+128", "+129", "+130", "+131", "+132", "+133", "+134",
+    "+135", "+136", "+137", "+138", "+139", "+140", "+141", "+142", "+143",
+    "+144", "+145", "+146", "+147", "+148", "+149", "+150", "+151", "+152",
+    "+153", "+154", "+155", "+156", "+157", "+158", "+159", "+160", "+161",
+    "+162", "+163", "+164", "+165", "+166", "+167", "+168", "+169", "+170",
+    "+171", "+172", "+173", "+174", "+175", "+176", "+177", "+178", "+179",
+    "+180", "+181", "+182", "+183", "+184", "+185", "+186", "+187", "+188",
+    "+189", "+190", "+191", "+192", "+193", "+194", "+195", "+196", "+197",
+    "+198", "+199", "+200", "+201", "+202", "+203", "+204", "+205", "+206",
+    "+207", "+208", "+209", "+210", "+211", "+212", "+213", "+214", "+215",
+    "+216", "+217", "+218", "+219", "+220", "+221", "+222", "+223", "+224",
+    "+225", "+226", "+227", "+228", "+229", "+230", "+231", "+232", "+233",
+    "+234", "+235", "+236", "+237", "+238", "+239", "+240", "+241", "+242",
+    "+243", "+244", "+245", "+246", "+247", "+248", "+249", "+250", "+251",
+    "+252", "+253", "+254", "+255", "+256", "+257", "+258", "+259", "+260",
+    "+261", "+262", "+263", "+264", "+265", "+266", "+267", "+268", "+269",
+    "+270", "+271", "+272", "+273", "+274", "+275", "+276", "+277", "+278",
+    "+279", "+280", "+281", "+282", "+283", "+284", "+285", "+286", "+287",
+    "+288", "+289", "+290", "+291", "+292", "+293", "+294", "+295", "+296",
+    "+297", "+298", "+299", "+300", "+301", "+302", "+303", "+304", "+305",
+    "+306", "+307", "+308",
+};
+
+// Prints v in scientific notation, using ech as the exponent character and
+// point as the decimal point. If plus is set, non-negative exponents are
+// prefixed with a '+'.
+static inline int to_chars(const floating_decimal_64 v, const bool sign, 
+    const char ech, const bool plus, const char point, char* const result)
+{
+    // Step 5: Print the decimal representation.
+    const int index = sign;
+    const uint64_t output = v.mantissa;
+    const uint32_t olength = decimalLength17(output);
+
+#ifdef RYU_DEBUG
+    printf("DIGITS=%" PRIu64 "\n", v.mantissa);
+    printf("OLEN=%u\n", olength);
+    printf("EXP=%u\n", v.exponent + olength);
+#endif
+
+    // Store the exponent first, when the output is at least as long as a
+    // table entry, so that the sign and digits overwrite its padding.
+    const int32_t exp = v.exponent + (int32_t) olength - 1;
+    assert(exp >= EXPONENT_MIN && exp <= EXPONENT_MAX);
+    const uint32_t aexp = (uint32_t) (exp < 0 ? -exp : exp);
+    const int elen = 1 + (aexp >= 10) + (aexp >= 100) + (exp < 0 || plus);
+    const char *suffix = EXPONENT_TABLE[exp - EXPONENT_MIN];
+    const int front = index + (int) olength + (olength > 1) + 1;
+    if (front + elen >= 4) {
+        memcpy(result + front + elen - 4, suffix, 4);
     }
 
-    // Print the exponent.
-    result[index++] = 'E';
-    int32_t exp = v.exponent + (int32_t) olength - 1;
-    if (exp < 0) {
-        result[index++] = '-';
-        exp = -exp;
+    if (sign) {
+        result[0] = '-';
     }
 
-    if (exp >= 100) {
-        const int32_t c = exp % 10;
-        memcpy(result + index, DIGIT_TABLE + 2 * (exp / 10), 2);
-        result[index + 2] = (char) ('0' + c);
-        index += 3;
-    } else if (exp >= 10) {
-        memcpy(result + index, DIGIT_TABLE + 2 * exp, 2);
-        index += 2;
-    } else {
-        result[index++] = (char) ('0' + exp);
+    // Print the decimal digits, leaving a gap after the first digit for the
+    // decimal dot.
+    write_digits(output, olength, result + index + 1);
+    result[index] = result[index + 1];
+
+    // Print decimal point if needed.
+    if (olength > 1) {
+        result[index + 1] = point;
     }
+    result[front - 1] = ech;
 
-    return index;
+    // Only outputs like "1e5" are shorter than a table entry.
+    if (front + elen < 4) {
+        memcpy(result + front, suffix + 4 - elen, (size_t) elen);
+    }
+    return front + elen;
 }
 
-static inline bool d2d_small_int(const uint64_t ieeeMantissa,
+// Returns the number of bytes that to_chars writes for v.
+static inline int exp_length(const floating_decimal_64 v, const bool sign,
+    const bool plus)
+{
+    const int32_t olength = (int32_t) decimalLength17(v.mantissa);
+    int32_t exp = v.exponent + olength - 1;
+    int len = sign + olength + (olength > 1) + 1;
+    if (exp < 0) {
+        len++;
+        exp = -exp;
+    } else {
+        len += plus;
+    }
+    return len + (exp >= 100 ? 3 : exp >= 10 ? 2 : 1);
+}
+
+// The longest fixed-point output: a sign, "0.", 323 leading zeros and
+// 17 digits.
+#define FIXED_MAX_LENGTH 343
+
+// Returns the number of bytes that to_chars_fixed writes for v.
+static inline int fixed_length(const floating_decimal_64 v, const bool sign) {
+    const int32_t olength = (int32_t) decimalLength17(v.mantissa);
+    const int32_t exp = v.exponent + olength - 1;
+    if (exp < 0) {
+        return sign + 1 - exp + olength;
+    }
+    if (exp + 1 >= olength) {
+        return sign + exp + 1;
+    }
+    if (exp + 2 == olength && v.mantissa % 10 == 0) {
+        return sign + exp + 1;
+    }
+    return sign + olength + 1;
+}
+
+// Prints v in fixed-point notation, without an exponent, using point as the
+// decimal point. The decimal point is placed directly from the exponent, so
+// no scientific notation is produced along the way. If dotzero is set,
+// integers are suffixed with the decimal point and a '0'.
+static inline int to_chars_fixed(const floating_decimal_64 v, const bool sign,
+    const char point, const bool dotzero, char* const result)
+{
+    int index = 0;
+    if (sign) {
+        result[index++] = '-';
+    }
+    const uint64_t output = v.mantissa;
+    const int32_t olength = (int32_t) decimalLength17(output);
+    const int32_t exp = v.exponent + olength - 1;
+    if (exp < 0) {
+        // 0.000ddd
+        result[index++] = '0';
+        result[index++] = point;
+        memset(result + index, '0', (size_t) (-exp - 1));
+        index += -exp - 1;
+        write_digits(output, (uint32_t) olength, result + index);
+        return index + olength;
+    } else if (exp + 1 >= olength) {
+        // ddd000
+        write_digits(output, (uint32_t) olength, result + index);
+        memset(result + index + olength, '0', (size_t) (exp + 1 - olength));
+        index += exp + 1;
+    } else {
+        // ddd.ddd
+        const int32_t ilength = exp + 1;
+        write_digits(output, (uint32_t) olength, result + index);
+        if (ilength + 1 == olength && result[index + ilength] == '0') {
+            // A lone trailing zero after the decimal point is dropped.
+            index += ilength;
+        } else {
+            memmove(result + index + ilength + 1, result + index + ilength, 
+                (size_t) (olength - ilength));
+            result[index + ilength] = point;
+            return index + olength + 1;
+        }
+    }
+    if (dotzero) {
+        result[index++] = point;
+        result[index++] = '0';
+    }
+    return index;
+}
+
+// Returns true if to_chars_fixed prints v as an integer, without a decimal
+// point.
+static inline bool fixed_integer(const floating_decimal_64 v) {
+    const int32_t olength = (int32_t) decimalLength17(v.mantissa);
+    const int32_t exp = v.exponent + olength - 1;
+    return exp >= 0 && (exp + 1 >= olength || 
+        (exp + 2 == olength && v.mantissa % 10 == 0));
+}
+
+// Multiplicative inverses of 5^8, 5^4, 5^2 and 5 modulo 2^64, and the
+// largest quotients (2^64-1) / 10^k for the same powers.
+static const uint64_t POW5_INV_64[4] = {
+    0xc767074b22e90e21u, 0xd288ce703afb7e91u, 0x8f5c28f5c28f5c29u, 
+    0xcccccccccccccccdu
+};
+static const uint64_t POW10_MAX_64[4] = {
+    184467440737u, 1844674407370955u, 184467440737095516u, 
+    1844674407370955161u
+};
+
+// Moves the trailing decimal zeros of v->mantissa, which is less than 2^53,
+// into v->exponent. Instead of dividing by 10 once per zero, tests for
+// 10^8, 10^4, 10^2 and 10 in turn: x is a multiple of 10^k exactly when
+// rotating x * 5^-k right by k bits gives at most (2^64-1) / 10^k, and the
+// result is then x / 10^k.
+static inline void remove_trailing_zeros(floating_decimal_64* const v) {
+    uint64_t m = v->mantissa;
+    int32_t e = v->exponent;
+    for (int32_t i = 0, k = 8; i < 4; i++, k >>= 1) {
+        const uint64_t x = m * POW5_INV_64[i];
+        const uint64_t q = (x >> k) | (x << (64 - k));
+        if (q <= POW10_MAX_64[i]) {
+            m = q;
+            e += k;
+        }
+    }
+    v->mantissa = m;
+    v->exponent = e;
+}
+
+static inline bool d2d_small_int(const uint64_t ieeeMantissa,
     const uint32_t ieeeExponent, floating_decimal_64* const v)
 {
     const uint64_t m2 = (1ull << DOUBLE_MANTISSA_BITS) | ieeeMantissa;
@@ -1743,9 +2556,15 @@ static inline bool d2d_small_int(const uint64_t ieeeMantissa,
     return true;
 }
 
-static int d2s_buffered_n(double f, char* result) {
+// Decodes f into its sign and shortest decimal representation. Zero decodes
+// to a mantissa of 0. Returns false for NaN and Infinity, in which case
+// v->mantissa is non-zero only for NaN.
+static inline bool d2s_decode(const double f, bool* const sign, 
+    floating_decimal_64* const v)
+{
     // Step 1: Decode the floating-point number, and unify normalized and
     // subnormal cases.
+    RYU_PROFILE_BEGIN(start);
     const uint64_t bits = double_to_bits(f);
 
 #ifdef RYU_DEBUG
@@ -1762,179 +2581,3631 @@ static int d2s_buffered_n(double f, char* result) {
     const uint64_t ieeeMantissa = bits & ((1ull << DOUBLE_MANTISSA_BITS) - 1);
     const uint32_t ieeeExponent = (uint32_t) ((bits >> DOUBLE_MANTISSA_BITS) & 
         ((1u << DOUBLE_EXPONENT_BITS) - 1));
+    *sign = ieeeSign;
     // Case distinction; exit early for the easy cases.
-    if (ieeeExponent == ((1u << DOUBLE_EXPONENT_BITS) - 1u) || 
-        (ieeeExponent == 0 && ieeeMantissa == 0))
-    {
-        return copy_special_str(result, ieeeSign, ieeeExponent, ieeeMantissa);
+    if (ieeeExponent == ((1u << DOUBLE_EXPONENT_BITS) - 1u)) {
+        RYU_STAT(special);
+        v->mantissa = ieeeMantissa;
+        v->exponent = 0;
+        RYU_PROFILE_END(RYU_PROFILE_DECODE, start);
+        return false;
+    }
+    if (ieeeExponent == 0 && ieeeMantissa == 0) {
+        RYU_STAT(zero);
+        v->mantissa = 0;
+        v->exponent = 0;
+        RYU_PROFILE_END(RYU_PROFILE_DECODE, start);
+        return true;
     }
 
-    floating_decimal_64 v;
-    const bool isSmallInt = d2d_small_int(ieeeMantissa, ieeeExponent, &v);
+    const bool isSmallInt = d2d_small_int(ieeeMantissa, ieeeExponent, v);
+    RYU_STAT_ADD(small_int, isSmallInt);
+    RYU_STAT_ADD(general, !isSmallInt);
     if (isSmallInt) {
         // For small integers in the range [1, 2^53), v.mantissa might contain 
         // trailing (decimal) zeros.
         // For scientific notation we need to move these zeros into the 
         // exponent.
-        // (This is not needed for fixed-point notation, so it might be
-        // beneficial to trim
-        // trailing zeros in to_chars only if needed - once fixed-point
-        // notation output is implemented.)
-        for (;;) {
-            const uint64_t q = div10(v.mantissa);
-            const uint32_t r = ((uint32_t) v.mantissa) - 10 * ((uint32_t) q);
-            if (r != 0) {
-                break;
-            }
-            v.mantissa = q;
-            ++v.exponent;
-        }
+        remove_trailing_zeros(v);
     } else {
-        v = d2d(ieeeMantissa, ieeeExponent);
+        RYU_PROFILE_BEGIN(d2dStart);
+        *v = d2d(ieeeMantissa, ieeeExponent);
+        RYU_PROFILE_NESTED(RYU_PROFILE_D2D, d2dStart, start);
     }
+    RYU_PROFILE_END(RYU_PROFILE_DECODE, start);
+    return true;
+}
 
-    return to_chars(v, ieeeSign, result);
+static int d2s_buffered_n(double f, char* result) {
+    bool sign;
+    floating_decimal_64 v;
+    if (!d2s_decode(f, &sign, &v)) {
+        return copy_special_str(result, sign, true, v.mantissa != 0);
+    }
+    if (v.mantissa == 0) {
+        return copy_special_str(result, sign, false, false);
+    }
+    return to_chars(v, sign, 'E', false, '.', result);
 }
 
 static void d2s_buffered(double f, char* result) {
-    (void)umul128; (void)shiftright128; (void)mod1e9;
+    (void)umul128; (void)shiftright128;
     const int index = d2s_buffered_n(f, result);
 
     // Terminate the string.
     result[index] = '\0';
 }
 
-#ifndef RYU_NOWRITER
-struct writer {
-    uint8_t *dst;
-    size_t n;
-    size_t count;
+#define FLOAT_MANTISSA_BITS 23
+#define FLOAT_EXPONENT_BITS 8
+#define FLOAT_BIAS 127
+
+// These tables are generated by PrintFloatLookupTable.
+#define FLOAT_POW5_INV_BITCOUNT 59
+#define FLOAT_POW5_BITCOUNT 61
+
+static const uint64_t FLOAT_POW5_INV_SPLIT[55] = {
+576460752303423489u,   461168601842738791u,   368934881474191033u,
+      295147905179352826u,   472236648286964522u,   377789318629571618u,
+      302231454903657294u,   483570327845851670u,   386856262276681336u,
+      309485009821345069u,   495176015714152110u,   396140812571321688u,
+      316912650057057351u,   507060240091291761u,   405648192073033409u,
+      324518553658426727u,   519229685853482763u,   415383748682786211u,
+      332306998946228969u,   531691198313966350u,   425352958651173080u,
+      340282366920938464u,   544451787073501542u,   435561429658801234u,
+      348449143727040987u,   557518629963265579u,   446014903970612463u,
+      356811923176489971u,   570899077082383953u,   456719261665907162u,
+      365375409332725730u,   292300327466180584u,   467680523945888934u,
+      374144419156711148u,   299315535325368918u,   478904856520590269u,
+      383123885216472215u,   306499108173177772u,   490398573077084435u,
+      392318858461667548u,   313855086769334039u,   502168138830934462u,
+      401734511064747569u,   321387608851798056u,   514220174162876889u,
+      411376139330301511u,   329100911464241209u,   526561458342785934u,
+      421249166674228747u,   336999333339382998u,   539198933343012796u,
+      431359146674410237u,   345087317339528190u,   552139707743245103u,
+      441711766194596083u
+};
+
+static const uint64_t FLOAT_POW5_SPLIT[47] = {
+     1152921504606846976u,  1441151880758558720u,  1801439850948198400u,
+     2251799813685248000u,  1407374883553280000u,  1759218604441600000u,
+     2199023255552000000u,  1374389534720000000u,  1717986918400000000u,
+     2147483648000000000u,  1342177280000000000u,  1677721600000000000u,
+     2097152000000000000u,  1310720000000000000u,  1638400000000000000u,
+     2048000000000000000u,  1280000000000000000u,  1600000000000000000u,
+     2000000000000000000u,  1250000000000000000u,  1562500000000000000u,
+     1953125000000000000u,  1220703125000000000u,  1525878906250000000u,
+     1907348632812500000u,  1192092895507812500u,  1490116119384765625u,
+     1862645149230957031u,  1164153218269348144u,  1455191522836685180u,
+     1818989403545856475u,  2273736754432320594u,  1421085471520200371u,
+     1776356839400250464u,  2220446049250313080u,  1387778780781445675u,
+     1734723475976807094u,  2168404344971008868u,  1355252715606880542u,
+     1694065894508600678u,  2117582368135750847u,  1323488980084844279u,
+     1654361225106055349u,  2067951531382569187u,  1292469707114105741u,
+     1615587133892632177u,  2019483917365790221u
 };
 
-static void write_nullterm(struct writer *wr) {
-    if (wr->n > wr->count) wr->dst[wr->count] = '\0';
-    else if (wr->n > 0) wr->dst[wr->n-1] = '\0';
+static inline uint32_t pow5factor_32(uint32_t value) {
+    uint32_t count = 0;
+    for (;;) {
+        assert(value != 0);
+        const uint32_t q = value / 5;
+        const uint32_t r = value % 5;
+        if (r != 0) {
+            break;
+        }
+        value = q;
+        ++count;
+    }
+    return count;
+}
+
+// Returns true if value is divisible by 5^p.
+static inline bool multipleOfPowerOf5_32(const uint32_t value, 
+    const uint32_t p)
+{
+    return pow5factor_32(value) >= p;
+}
+
+// Returns true if value is divisible by 2^p.
+static inline bool multipleOfPowerOf2_32(const uint32_t value, 
+    const uint32_t p)
+{
+    // __builtin_ctz doesn't appear to be faster here.
+    return (value & ((1u << p) - 1)) == 0;
+}
+
+// It seems to be slightly faster to avoid uint128_t here, although the
+// generated code for uint128_t looks slightly nicer.
+static inline uint32_t mulShift32(const uint32_t m, const uint64_t factor, 
+    const int32_t shift)
+{
+    assert(shift > 32);
+
+    // The casts here help MSVC to avoid calls to the __allmul library
+    // function.
+    const uint32_t factorLo = (uint32_t)(factor);
+    const uint32_t factorHi = (uint32_t)(factor >> 32);
+    const uint64_t bits0 = (uint64_t)m * factorLo;
+    const uint64_t bits1 = (uint64_t)m * factorHi;
+
+#if defined(RYU_32_BIT_PLATFORM)
+    // On 32-bit platforms we can avoid a 64-bit shift-right since we only
+    // need the upper 32 bits of the result and the shift value is > 32.
+    const uint32_t bits0Hi = (uint32_t)(bits0 >> 32);
+    uint32_t bits1Lo = (uint32_t)(bits1);
+    uint32_t bits1Hi = (uint32_t)(bits1 >> 32);
+    bits1Lo += bits0Hi;
+    bits1Hi += (bits1Lo < bits0Hi);
+    const int32_t s = shift - 32;
+    return (bits1Hi << (32 - s)) | (bits1Lo >> s);
+#else // RYU_32_BIT_PLATFORM
+    const uint64_t sum = (bits0 >> 32) + bits1;
+    const uint64_t shiftedSum = sum >> (shift - 32);
+    assert(shiftedSum <= UINT32_MAX);
+    return (uint32_t) shiftedSum;
+#endif // RYU_32_BIT_PLATFORM
+}
+
+static inline uint32_t mulPow5InvDivPow2(const uint32_t m, const uint32_t q, 
+    const int32_t j)
+{
+    return mulShift32(m, FLOAT_POW5_INV_SPLIT[q], j);
 }
 
-static void write_char(struct writer *wr, char b) {
-    if (wr->count < wr->n) wr->dst[wr->count] = b;
-    wr->count++;
+static inline uint32_t mulPow5divPow2(const uint32_t m, const uint32_t i, 
+    const int32_t j)
+{
+    return mulShift32(m, FLOAT_POW5_SPLIT[i], j);
 }
+
+// A floating decimal representing m * 10^e.
+typedef struct floating_decimal_32 {
+    uint32_t mantissa;
+    // Decimal exponent's range is -45 to 38
+    // inclusive, and can fit in a short if needed.
+    int32_t exponent;
+} floating_decimal_32;
+
+// Converts a binary float with mantissaBits explicit mantissa bits and the
+// exponent bias, which is a float, or a narrower format whose exponents are
+// in the range of a float, such as fp16 and bfloat16.
+static inline floating_decimal_32 f2d(const uint32_t ieeeMantissa, 
+    const uint32_t ieeeExponent, const int32_t mantissaBits, 
+    const int32_t bias)
+{
+    int32_t e2;
+    uint32_t m2;
+    if (ieeeExponent == 0) {
+        // We subtract 2 so that the bounds computation has 2 additional bits.
+        e2 = 1 - bias - mantissaBits - 2;
+        m2 = ieeeMantissa;
+    } else {
+        e2 = (int32_t) ieeeExponent - bias - mantissaBits - 2;
+        m2 = (1u << mantissaBits) | ieeeMantissa;
+    }
+    const bool even = (m2 & 1) == 0;
+    const bool acceptBounds = even;
+
+#ifdef RYU_DEBUG
+    printf("-> %u * 2^%d\n", m2, e2 + 2);
 #endif
 
-RYU_EXTERN
-size_t ryu_string(double d, char fmt, char dst[], size_t nbytes) {
-    struct writer wr = { .dst = (uint8_t*)dst, .n = nbytes };
-    char buf[25];
-    bool f = true;
-    bool g = false;
-    bool j = false;
-    char ech = 'e';
-    switch (fmt) {
-    case 'j': case 'J':
-        fmt -= 3;
-        j = true;
-        // fall through
-    case 'g': case 'G':
-        fmt -= 2;
-        g = true;
-        // fall through
-    case 'e': case 'E':
-        f = g;
-        if (fmt == 'E') ech = 'E';
-        // fall through
-    case 'f':
-        d2s_buffered(d, buf);
-        break;
-    default:
-        buf[0] = '\0';
-    }
-    bool neg = false;
-    char *p = buf;
-    if (p[0] == '-') {
-        write_char(&wr, '-');
-        p++;
-        neg = true;
-    }
-    char *end = p;
-    char *e = NULL;
-    while (*end) {
-        if (*end >= 'E' && (*end == 'E' || *end == 'e')) {
-            e = end;
-        }
-        end++;
-    } 
-    if (!e) {
-        if (*p == 'i' || *p == 'I') {
-            strcpy(p, "Infinity");
-        } else if (*p == 'n' || *p == 'N') {
-            strcpy(p, "NaN");
-        } else {
-            *p = '\0';
-        }
-        while (*p) write_char(&wr, *(p++));
-        write_nullterm(&wr);
-        return wr.count;
-    }
-    if (!f) {
-        *e = '\0';
-        while (*p) write_char(&wr, *(p++));
-        write_char(&wr, ech);
-        p++;
-        if (j && *p != '-') write_char(&wr, '+');
-        while (*p) write_char(&wr, *(p++));
-        write_nullterm(&wr);
-        return wr.count;
-    }
-    int en = atoi(e+1);
-    *e = '\0';
-    if (en < 0) {
-        write_char(&wr, '0');
-        write_char(&wr, '.');
-        en = -en;
-        for (int i = 0; i < en-1; i++) {
-            write_char(&wr, '0');
-        }
-        write_char(&wr, *(p++));
-        if (*p) {
-            p++;
-            while (*p) write_char(&wr, *(p++));
+    // Step 2: Determine the interval of valid decimal representations.
+    const uint32_t mv = 4 * m2;
+    const uint32_t mp = 4 * m2 + 2;
+    // Implicit bool -> int conversion. True is 1, false is 0.
+    const uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+    const uint32_t mm = 4 * m2 - 1 - mmShift;
+
+    // Step 3: Convert to a decimal power base using 64-bit arithmetic.
+    uint32_t vr, vp, vm;
+    int32_t e10;
+    bool vmIsTrailingZeros = false;
+    bool vrIsTrailingZeros = false;
+    uint8_t lastRemovedDigit = 0;
+    if (e2 >= 0) {
+        const uint32_t q = log10Pow2(e2);
+        e10 = (int32_t) q;
+        const int32_t k = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32_t) q) - 1;
+        const int32_t i = -e2 + (int32_t) q + k;
+        vr = mulPow5InvDivPow2(mv, q, i);
+        vp = mulPow5InvDivPow2(mp, q, i);
+        vm = mulPow5InvDivPow2(mm, q, i);
+#ifdef RYU_DEBUG
+        printf("%u * 2^%d / 10^%u\n", mv, e2, q);
+        printf("V+=%u\nV =%u\nV-=%u\n", vp, vr, vm);
+#endif
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            // We need to know one removed digit even if we are not going to
+            // loop below. We could use q = X - 1 above, except that would
+            // require 33 bits for the result, and we've found that 32-bit
+            // arithmetic is faster even on 64-bit machines.
+            const int32_t l = FLOAT_POW5_INV_BITCOUNT + 
+                pow5bits((int32_t) (q - 1)) - 1;
+            lastRemovedDigit = (uint8_t) (mulPow5InvDivPow2(mv, q - 1, 
+                -e2 + (int32_t) q - 1 + l) % 10);
         }
-    } else {
-        write_char(&wr, *(p++));
-        if (*p) p++;
-        for (int i = 0; i < en; i++) {
-            if (*p) {
-                write_char(&wr, *(p++));
+        if (q <= 9) {
+            // The largest power of 5 that fits in 24 bits is 5^10, but q <= 9
+            // seems to be safe as well. Only one of mp, mv, and mm can be a
+            // multiple of 5, if any.
+            if (mv % 5 == 0) {
+                vrIsTrailingZeros = multipleOfPowerOf5_32(mv, q);
+            } else if (acceptBounds) {
+                vmIsTrailingZeros = multipleOfPowerOf5_32(mm, q);
             } else {
-                write_char(&wr, '0');
+                vp -= multipleOfPowerOf5_32(mp, q);
             }
         }
-        if (*p && !(*p == '0' && *(p+1) == '\0')) {
-            write_char(&wr, '.');
-            while (*p) write_char(&wr, *(p++));
+    } else {
+        const uint32_t q = log10Pow5(-e2);
+        e10 = (int32_t) q + e2;
+        const int32_t i = -e2 - (int32_t) q;
+        const int32_t k = pow5bits(i) - FLOAT_POW5_BITCOUNT;
+        int32_t j = (int32_t) q - k;
+        vr = mulPow5divPow2(mv, (uint32_t) i, j);
+        vp = mulPow5divPow2(mp, (uint32_t) i, j);
+        vm = mulPow5divPow2(mm, (uint32_t) i, j);
+#ifdef RYU_DEBUG
+        printf("%u * 5^%d / 10^%u\n", mv, -e2, q);
+        printf("%u %d %d %d\n", q, i, k, j);
+        printf("V+=%u\nV =%u\nV-=%u\n", vp, vr, vm);
+#endif
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            j = (int32_t) q - 1 - (pow5bits(i + 1) - FLOAT_POW5_BITCOUNT);
+            lastRemovedDigit = (uint8_t) (mulPow5divPow2(mv, 
+                (uint32_t) (i + 1), j) % 10);
+        }
+        if (q <= 1) {
+            // {vr,vp,vm} is trailing zeros if {mv,mp,mm} has at least q 
+            // trailing 0 bits. mv = 4 * m2, so it always has at least two 
+            // trailing 0 bits.
+            vrIsTrailingZeros = true;
+            if (acceptBounds) {
+                // mm = mv - 1 - mmShift, so it has 1 trailing 0 bit iff 
+                // mmShift == 1.
+                vmIsTrailingZeros = mmShift == 1;
+            } else {
+                // mp = mv + 2, so it always has at least one trailing 0 bit.
+                --vp;
+            }
+        } else if (q < 31) { // TODO(ulfjack): Use a tighter bound here.
+            vrIsTrailingZeros = multipleOfPowerOf2_32(mv, q - 1);
+#ifdef RYU_DEBUG
+            printf("vr is trailing zeros=%s\n", vrIsTrailingZeros ? "true" : 
+                "false");
+#endif
         }
     }
-    write_nullterm(&wr);
-    if (g) {
-        bool rewrite = false;
-        if (j) {
-            rewrite = neg ? wr.count > 22 : wr.count > 21;
-        } else {
-            rewrite = (size_t)(end-buf) < wr.count;
+#ifdef RYU_DEBUG
+    printf("e10=%d\n", e10);
+    printf("V+=%u\nV =%u\nV-=%u\n", vp, vr, vm);
+    printf("vm is trailing zeros=%s\n", vmIsTrailingZeros ? "true" : "false");
+    printf("vr is trailing zeros=%s\n", vrIsTrailingZeros ? "true" : "false");
+#endif
+
+    // Step 4: Find the shortest decimal representation in the interval of 
+    // valid representations.
+    int32_t removed = 0;
+    uint32_t output;
+    if (vmIsTrailingZeros || vrIsTrailingZeros) {
+        // General case, which happens rarely (~4.0%).
+        RYU_STAT(trailing_zeros);
+        while (vp / 10 > vm / 10) {
+            vmIsTrailingZeros &= vm % 10 == 0;
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = (uint8_t) (vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+#ifdef RYU_DEBUG
+        printf("V+=%u\nV =%u\nV-=%u\n", vp, vr, vm);
+        printf("d-10=%s\n", vmIsTrailingZeros ? "true" : "false");
+#endif
+        if (vmIsTrailingZeros) {
+            while (vm % 10 == 0) {
+                vrIsTrailingZeros &= lastRemovedDigit == 0;
+                lastRemovedDigit = (uint8_t) (vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                ++removed;
+            }
+        }
+#ifdef RYU_DEBUG
+        printf("%u %d\n", vr, lastRemovedDigit);
+        printf("vr is trailing zeros=%s\n", vrIsTrailingZeros ? "true" : 
+            "false");
+#endif
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+            // Round even if the exact number is .....50..0.
+            lastRemovedDigit = 4;
         }
-        if (rewrite) {
-            // rewind and rewrite the buffer
-            wr = (struct writer){ .dst = (uint8_t*)dst, .n = nbytes };
-            p = buf;
-            *e = '\0';
-            while (*p) write_char(&wr, *(p++));
-            write_char(&wr, ech);
-            p++;
-            if (j && *p != '-') write_char(&wr, '+');
-            while (*p) write_char(&wr, *(p++));
-            write_nullterm(&wr);
+        // We need to take vr + 1 if vr is outside bounds or we need to round up.
+        output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || 
+            lastRemovedDigit >= 5);
+    } else {
+        // Specialized for the common case (~96.0%). Percentages below are 
+        // relative to this.
+        // Loop iterations below (approximately):
+        // 0: 13.6%, 1: 70.7%, 2: 14.1%, 3: 1.39%, 4: 0.14%, 5+: 0.01%
+        while (vp / 10 > vm / 10) {
+            lastRemovedDigit = (uint8_t) (vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
         }
+#ifdef RYU_DEBUG
+        printf("%u roundUp=%s\n", vr, lastRemovedDigit >= 5 ? "true" : 
+            "false");
+        printf("vr is trailing zeros=%s\n", vrIsTrailingZeros ? "true" : 
+            "false");
+#endif
+        // We need to take vr + 1 if vr is outside bounds or we need to round 
+        // up.
+        output = vr + (vr == vm || lastRemovedDigit >= 5);
+    }
+    const int32_t exp = e10 + removed;
+
+#ifdef RYU_DEBUG
+    printf("V+=%u\nV =%u\nV-=%u\n", vp, vr, vm);
+    printf("O=%u\n", output);
+    printf("EXP=%d\n", exp);
+#endif
+
+    floating_decimal_32 fd;
+    fd.exponent = exp;
+    fd.mantissa = output;
+    return fd;
+}
+
+static inline uint32_t float_to_bits(const float f) {
+    uint32_t bits = 0;
+    memcpy(&bits, &f, sizeof(float));
+    return bits;
+}
+
+// Decodes the bits of a binary float, laid out with mantissaBits and
+// exponentBits, into its sign and shortest decimal representation, widened
+// to a floating_decimal_64 so it can be printed with the same routines as a
+// double. Follows the same rules as d2s_decode.
+static inline bool f2s_decode_bits(const uint32_t bits, 
+    const int32_t mantissaBits, const int32_t exponentBits, 
+    const int32_t bias, bool* const sign, floating_decimal_64* const v)
+{
+    // Decode bits into sign, mantissa, and exponent.
+    const bool ieeeSign = ((bits >> (mantissaBits + exponentBits)) & 1) != 0;
+    const uint32_t ieeeMantissa = bits & ((1u << mantissaBits) - 1);
+    const uint32_t ieeeExponent = (bits >> mantissaBits) & 
+        ((1u << exponentBits) - 1);
+    *sign = ieeeSign;
+    // Case distinction; exit early for the easy cases.
+    if (ieeeExponent == ((1u << exponentBits) - 1u)) {
+        RYU_STAT(special);
+        v->mantissa = ieeeMantissa;
+        v->exponent = 0;
+        return false;
+    }
+    if (ieeeExponent == 0 && ieeeMantissa == 0) {
+        RYU_STAT(zero);
+        v->mantissa = 0;
+        v->exponent = 0;
+        return true;
+    }
+    RYU_STAT(general);
+    const floating_decimal_32 fd = f2d(ieeeMantissa, ieeeExponent, 
+        mantissaBits, bias);
+    v->mantissa = fd.mantissa;
+    v->exponent = fd.exponent;
+    return true;
+}
+
+// Decodes f like f2s_decode_bits.
+static inline bool f2s_decode(const float f, bool* const sign, 
+    floating_decimal_64* const v)
+{
+    // Step 1: Decode the floating-point number, and unify normalized and
+    // subnormal cases.
+    const uint32_t bits = float_to_bits(f);
+
+#ifdef RYU_DEBUG
+    printf("IN=");
+    for (int32_t bit = 31; bit >= 0; --bit) {
+        printf("%u", (bits >> bit) & 1);
+    }
+    printf("\n");
+#endif
+
+    return f2s_decode_bits(bits, FLOAT_MANTISSA_BITS, FLOAT_EXPONENT_BITS, 
+        FLOAT_BIAS, sign, v);
+}
+
+#define HALF_MANTISSA_BITS 10
+#define HALF_EXPONENT_BITS 5
+#define HALF_BIAS 15
+
+#define BFLOAT_MANTISSA_BITS 7
+#define BFLOAT_EXPONENT_BITS 8
+#define BFLOAT_BIAS 127
+
+// Decodes the bits of an IEEE fp16, or of a bfloat16 if bfloat is set, like
+// f2s_decode. The same f2d conversion and tables as a float are used, on the
+// narrower mantissa, so the digits are the shortest for the 16-bit value.
+static inline bool h2s_decode(const uint16_t bits, const bool bfloat,
+    bool* const sign, floating_decimal_64* const v)
+{
+    if (bfloat) {
+        return f2s_decode_bits(bits, BFLOAT_MANTISSA_BITS, 
+            BFLOAT_EXPONENT_BITS, BFLOAT_BIAS, sign, v);
+    }
+    return f2s_decode_bits(bits, HALF_MANTISSA_BITS, HALF_EXPONENT_BITS, 
+        HALF_BIAS, sign, v);
+}
+
+// Returns floor(log_2(5^e)); requires 0 <= e <= 3528.
+static inline int32_t log2pow5(const int32_t e) {
+    assert(e >= 0);
+    assert(e <= 3528);
+    return (int32_t) ((((uint32_t) e) * 1217359) >> 19);
+}
+
+// Returns floor(log_2(value)); requires value != 0.
+static inline uint32_t floor_log2(const uint64_t value) {
+    assert(value != 0);
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - (uint32_t) __builtin_clzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (uint32_t) index;
+#else
+    uint32_t index = 0;
+    for (uint64_t v = value >> 1; v != 0; v >>= 1) {
+        index++;
     }
-    return wr.count;
+    return index;
+#endif
+}
+
+static inline double int64Bits2Double(const uint64_t bits) {
+    double f;
+    memcpy(&f, &bits, sizeof(double));
+    return f;
 }
+
+// Converts m10 * 10^e10 to the nearest double. Requires m10 to have no more
+// than 17 digits.
+static inline double s2d_decimal(const uint64_t m10, const int32_t m10digits,
+    const int64_t e10_64, const bool signedM)
+{
+    if (m10 == 0 || m10digits + e10_64 <= -324) {
+        // Number is less than 1e-324, which should be rounded down to 0; 
+        // return +/-0.0.
+        const uint64_t ieee = ((uint64_t) signedM) << 
+            (DOUBLE_EXPONENT_BITS + DOUBLE_MANTISSA_BITS);
+        return int64Bits2Double(ieee);
+    }
+    if (m10digits + e10_64 >= 310) {
+        // Number is larger than 1e+309, which should be rounded to 
+        // +/-Infinity.
+        const uint64_t ieee = (((uint64_t) signedM) << 
+            (DOUBLE_EXPONENT_BITS + DOUBLE_MANTISSA_BITS)) | 
+            (0x7ffull << DOUBLE_MANTISSA_BITS);
+        return int64Bits2Double(ieee);
+    }
+    const int32_t e10 = (int32_t) e10_64;
+    if (e10 >= 0 && e10 <= 15 && m10 < (1ull << 53)) {
+        // An integer that is exact in a double needs no rounding.
+        uint64_t m = m10;
+        for (int32_t i = 0; i < e10 && m < (1ull << 53); i++) {
+            m *= 10;
+        }
+        if (m < (1ull << 53)) {
+            const double d = (double) m;
+            return signedM ? -d : d;
+        }
+    }
+
+    // Convert to binary float m2 * 2^e2, while retaining information about 
+    // whether the conversion was exact (trailingZeros).
+    int32_t e2;
+    uint64_t m2;
+    bool trailingZeros;
+    if (e10 >= 0) {
+        // The length of m * 10^e in bits is:
+        //   log2(m10 * 10^e10) = log2(m10) + e10 log2(10) 
+        //                      = log2(m10) + e10 + e10 * log2(5)
+        //
+        // We want to compute the DOUBLE_MANTISSA_BITS + 1 top-most bits (+1
+        // for the implicit leading one in IEEE format). We therefore choose a
+        // binary output exponent of
+        //   log2(m10 * 10^e10) - (DOUBLE_MANTISSA_BITS + 1).
+        //
+        // We use floor(log2(5^e10)) so that we get at least this many bits;
+        // better to have an additional bit than to not have enough bits.
+        e2 = (int32_t) floor_log2(m10) + e10 + log2pow5(e10) - 
+            (DOUBLE_MANTISSA_BITS + 1);
+
+        // We now compute [m10 * 10^e10 / 2^e2] = [m10 * 5^e10 / 2^(e2-e10)].
+        // To that end, we use the DOUBLE_POW5_SPLIT table.
+        const int32_t j = e2 - e10 - pow5bits(e10) + DOUBLE_POW5_BITCOUNT;
+        assert(j >= 0);
+#if defined(RYU_OPTIMIZE_SIZE) || defined(RYU_HOT_TABLES)
+        uint64_t pow5[2];
+        m2 = mulShift64(m10, double_pow5((uint32_t) e10, pow5), j);
+#else
+        assert(e10 < DOUBLE_POW5_TABLE_SIZE);
+        m2 = mulShift64(m10, DOUBLE_POW5_SPLIT[e10], j);
+#endif
+        // We also compute if the result is exact, i.e.,
+        //   [m10 * 10^e10 / 2^e2] == m10 * 10^e10 / 2^e2.
+        // This can only be the case if 2^e2 divides m10 * 10^e10, which in
+        // turn requires that the largest power of 2 that divides m10 + e10 is
+        // greater than e2. If e2 is less than e10, then the result must be
+        // exact. Otherwise we use the existing multipleOfPowerOf2 function.
+        trailingZeros = e2 < e10 || 
+            (e2 - e10 < 64 && multipleOfPowerOf2(m10, (uint32_t) (e2 - e10)));
+    } else {
+        e2 = (int32_t) floor_log2(m10) + e10 - pow5bits(-e10) - 
+            (DOUBLE_MANTISSA_BITS + 1);
+        const int32_t j = e2 - e10 + pow5bits(-e10) - 1 + 
+            DOUBLE_POW5_INV_BITCOUNT;
+#if defined(RYU_OPTIMIZE_SIZE) || defined(RYU_HOT_TABLES)
+        uint64_t pow5[2];
+        m2 = mulShift64(m10, double_invPow5((uint32_t) -e10, pow5), j);
+#else
+        assert(-e10 < DOUBLE_POW5_INV_TABLE_SIZE);
+        m2 = mulShift64(m10, DOUBLE_POW5_INV_SPLIT[-e10], j);
+#endif
+        trailingZeros = multipleOfPowerOf5(m10, (uint32_t) -e10);
+    }
+
+#ifdef RYU_DEBUG
+    printf("m2 * 2^e2 = %" PRIu64 " * 2^%d\n", m2, e2);
+#endif
+
+    // Compute the final IEEE exponent.
+    const int32_t e2f = e2 + DOUBLE_BIAS + (int32_t) floor_log2(m2);
+    uint32_t ieee_e2 = (uint32_t) (e2f > 0 ? e2f : 0);
+
+    if (ieee_e2 > 0x7fe) {
+        // Final IEEE exponent is larger than the maximum representable;
+        // return +/-Infinity.
+        const uint64_t ieee = (((uint64_t) signedM) << 
+            (DOUBLE_EXPONENT_BITS + DOUBLE_MANTISSA_BITS)) | 
+            (0x7ffull << DOUBLE_MANTISSA_BITS);
+        return int64Bits2Double(ieee);
+    }
+
+    // We need to figure out how much we need to shift m2. The tricky part is
+    // that we need to take the final IEEE exponent into account, so we need
+    // to reverse the bias and also special-case the value 0.
+    const int32_t shift = (ieee_e2 == 0 ? 1 : (int32_t) ieee_e2) - e2 - 
+        DOUBLE_BIAS - DOUBLE_MANTISSA_BITS;
+    assert(shift >= 0);
+#ifdef RYU_DEBUG
+    printf("ieee_e2 = %u\n", ieee_e2);
+    printf("shift = %d\n", shift);
+#endif
+
+    // We need to round up if the exact value is more than 0.5 above the value
+    // we computed. That's equivalent to checking if the last removed bit was
+    // 1 and either the value was not just trailing zeros or the result would
+    // otherwise be odd.
+    //
+    // We need to update trailingZeros given that we have the exact output
+    // exponent ieee_e2 now.
+    trailingZeros &= (m2 & ((1ull << (shift - 1)) - 1)) == 0;
+    const uint64_t lastRemovedBit = (m2 >> (shift - 1)) & 1;
+    const bool roundUp = (lastRemovedBit != 0) && 
+        (!trailingZeros || (((m2 >> shift) & 1) != 0));
+
+#ifdef RYU_DEBUG
+    printf("roundUp = %d\n", roundUp);
+    printf("ieee_m2 = %" PRIu64 "\n", (m2 >> shift) + roundUp);
+#endif
+    uint64_t ieee_m2 = (m2 >> shift) + roundUp;
+    assert(ieee_m2 <= (1ull << (DOUBLE_MANTISSA_BITS + 1)));
+    ieee_m2 &= (1ull << DOUBLE_MANTISSA_BITS) - 1;
+    if (ieee_m2 == 0 && roundUp) {
+        // Due to how the IEEE represents +/-Infinity, we don't need to check
+        // for overflow here.
+        ieee_e2++;
+    }
+
+    const uint64_t ieee = (((((uint64_t) signedM) << DOUBLE_EXPONENT_BITS) | 
+        (uint64_t) ieee_e2) << DOUBLE_MANTISSA_BITS) | ieee_m2;
+    return int64Bits2Double(ieee);
+}
+
+// Returns the value of the 8 digits at p, or -1 if they are not all digits.
+// The bytes are combined in pairs, fours and eights with multiply-shifts
+// instead of 8 dependent multiply-adds.
+static inline int32_t parse_eight_digits(const char* const p) {
+    uint64_t x = 0;
+    for (int32_t i = 7; i >= 0; i--) {
+        x = x << 8 | (uint8_t) p[i];
+    }
+    // Every byte is in '0'..'9' if its high nibble is 3, also after adding 6.
+    if (((x & 0xf0f0f0f0f0f0f0f0ull) | 
+        (((x + 0x0606060606060606ull) & 0xf0f0f0f0f0f0f0f0ull) >> 4)) != 
+        0x3333333333333333ull)
+    {
+        return -1;
+    }
+    x -= 0x3030303030303030ull;
+    x = x * 10 + (x >> 8);
+    x = (((x & 0x000000ff000000ffull) * (100 + (1000000ull << 32))) + 
+        (((x >> 16) & 0x000000ff000000ffull) * (1 + (10000ull << 32)))) >> 32;
+    return (int32_t) x;
+}
+
+// Parses the number at the start of buffer into result. Returns the number
+// of bytes consumed, or zero if buffer does not start with a number.
+static size_t s2d_n(const char* const buffer, const size_t len, 
+    double* const result)
+{
+    size_t i = 0;
+    bool signedM = false;
+    if (i < len && buffer[i] == '-') {
+        signedM = true;
+        i++;
+    }
+    if (i < len && (buffer[i] == 'I' || buffer[i] == 'N')) {
+        if (len - i >= 8 && memcmp(buffer + i, "Infinity", 8) == 0) {
+            *result = int64Bits2Double((((uint64_t) signedM) << 
+                (DOUBLE_EXPONENT_BITS + DOUBLE_MANTISSA_BITS)) | 
+                (0x7ffull << DOUBLE_MANTISSA_BITS));
+            return i + 8;
+        }
+        if (!signedM && len - i >= 3 && memcmp(buffer + i, "NaN", 3) == 0) {
+            *result = int64Bits2Double(0x7ff8ull << 48);
+            return i + 3;
+        }
+        return 0;
+    }
+
+    // Zeros that follow a significant digit are held back until a non-zero
+    // digit shows up, so trailing zeros don't count towards the 17 digits.
+    uint64_t m10 = 0;
+    int32_t m10digits = 0;
+    int64_t e10 = 0;
+    size_t zeros = 0;
+    size_t fracZeros = 0;
+    bool dot = false;
+    bool digits = false;
+    // Cleared when the eight digits at once fail, until the decimal point.
+    bool eight = true;
+    for (; i < len; i++) {
+        const char c = buffer[i];
+        if (c == '.') {
+            if (dot) {
+                break;
+            }
+            dot = true;
+            eight = true;
+            continue;
+        }
+        if (c < '0' || c > '9') {
+            break;
+        }
+        digits = true;
+        if (eight && zeros == 0 && m10digits <= 9 && (m10 != 0 || c != '0') &&
+            len - i >= 8)
+        {
+            // Eight digits at once, when none of them can be over the 17
+            // digits and no zeros are held back.
+            const int32_t value = parse_eight_digits(buffer + i);
+            if (value >= 0) {
+                m10 = 100000000 * m10 + (uint64_t) value;
+                m10digits += 8;
+                e10 -= dot ? 8 : 0;
+                i += 7;
+                continue;
+            }
+            eight = false;
+        }
+        if (c == '0') {
+            if (m10 != 0) {
+                zeros++;
+                fracZeros += dot;
+            } else if (dot) {
+                e10--;
+            }
+            continue;
+        }
+        if (m10digits + zeros >= 17) {
+            // Too many significant digits.
+            return 0;
+        }
+        for (; zeros > 0; zeros--) {
+            m10 *= 10;
+            m10digits++;
+        }
+        m10 = 10 * m10 + (uint64_t) (c - '0');
+        m10digits++;
+        e10 -= (int64_t) fracZeros + dot;
+        fracZeros = 0;
+    }
+    if (!digits) {
+        return 0;
+    }
+    e10 += (int64_t) (zeros - fracZeros);
+
+    if (i < len && (buffer[i] == 'e' || buffer[i] == 'E')) {
+        size_t k = i + 1;
+        bool signedE = false;
+        if (k < len && (buffer[k] == '-' || buffer[k] == '+')) {
+            signedE = buffer[k] == '-';
+            k++;
+        }
+        if (k < len && buffer[k] >= '0' && buffer[k] <= '9') {
+            int64_t exp = 0;
+            for (; k < len && buffer[k] >= '0' && buffer[k] <= '9'; k++) {
+                // Saturate, anything this large is zero or infinity.
+                if (exp < 1000000000) {
+                    exp = 10 * exp + (buffer[k] - '0');
+                }
+            }
+            e10 += signedE ? -exp : exp;
+            i = k;
+        }
+    }
+
+#ifdef RYU_DEBUG
+    printf("Input=%.*s\n", (int) i, buffer);
+    printf("m10digits = %d\n", m10digits);
+    printf("m10 * 10^e10 = %" PRIu64 " * 10^%" PRId64 "\n", m10, e10);
+#endif
+
+    *result = s2d_decimal(m10, m10digits, e10, signedM);
+    return i;
+}
+
+// Copies the len bytes in src to dst, but no more than nbytes. Returns len.
+static inline size_t write_partial(char dst[], size_t nbytes, const char *src,
+    size_t len)
+{
+    const size_t n = len < nbytes ? len : nbytes;
+    if (n > 0) {
+        memcpy(dst, src, n);
+    }
+    return len;
+}
+
+static inline size_t write_special(char dst[], size_t nbytes, bool sign, 
+    bool mantissa)
+{
+    if (mantissa) {
+        return write_partial(dst, nbytes, "NaN", 3);
+    }
+    return write_partial(dst, nbytes, "-Infinity" + !sign, 8 + sign);
+}
+
+// Prints the finite decoded value v into dst in a single pass, writing no
+// more than nbytes and no null-terminator. The output length is computed up
+// front, which also selects between the fixed and exponent forms for 'g' and
+// 'j'. The form does not depend on plus, point and dotzero, which are the
+// exponent sign, the decimal point and the ".0" of to_chars and
+// to_chars_fixed. The form is counted for RYU_STATS when count is set, which
+// the second pass over a value leaves out. Returns the full length of the
+// output.
+static inline size_t print_options(const floating_decimal_64 v, 
+    const bool sign, const bool f, const bool g, const bool j, 
+    const char ech, const bool plus, const char point, const bool dotzero, 
+    const bool count, char dst[], size_t nbytes)
+{
+    RYU_PROFILE_BEGIN(start);
+    bool fixed = f;
+    size_t len;
+    if (g) {
+        const size_t flen = (size_t) fixed_length(v, sign);
+        const size_t elen = (size_t) exp_length(v, sign, j);
+        if (j) {
+            // Javascript switches to exponents at 1e21.
+            fixed = flen <= (size_t) 21 + sign;
+        } else {
+            fixed = flen <= elen;
+        }
+        len = fixed ? flen : elen;
+        if (!fixed && plus != j) {
+            len = (size_t) exp_length(v, sign, plus);
+        }
+    } else if (fixed) {
+        len = (size_t) fixed_length(v, sign);
+    } else {
+        len = (size_t) exp_length(v, sign, plus);
+    }
+    if (fixed && dotzero && fixed_integer(v)) {
+        len += 2;
+    }
+    (void) count;
+    RYU_STAT_ADD(fixed, count && g && fixed);
+    RYU_STAT_ADD(exponent, count && g && !fixed);
+    if (nbytes == 0) {
+        return len;
+    }
+    // Print directly into the destination when the whole output fits.
+    char buf[FIXED_MAX_LENGTH];
+    char *p = len <= nbytes ? dst : buf;
+    if (fixed) {
+        to_chars_fixed(v, sign, point, dotzero, p);
+    } else {
+        to_chars(v, sign, ech, plus, point, p);
+    }
+    if (p == buf) {
+        memcpy(dst, buf, nbytes);
+    }
+    RYU_PROFILE_END(RYU_PROFILE_PRINT, start);
+    return len;
+}
+
+// Prints the decoded value v like print_options, with the exponent sign of
+// the format, and a value that is not finite as NaN or Infinity.
+static inline size_t print_format(const floating_decimal_64 v, 
+    const bool sign, const bool finite, const bool f, const bool g,
+    const bool j, const char ech, const bool count, char dst[], size_t nbytes)
+{
+    if (!finite) {
+        return write_special(dst, nbytes, sign, v.mantissa != 0);
+    }
+    return print_options(v, sign, f, g, j, ech, j, '.', false, count, dst, 
+        nbytes);
+}
+
+static inline size_t string_format(const floating_decimal_64 v, 
+    const bool sign, const bool finite, const bool f, const bool g,
+    const bool j, const char ech, char dst[], size_t nbytes)
+{
+    if (nbytes == 0) {
+        return print_format(v, sign, finite, f, g, j, ech, true, dst, 0);
+    }
+    const size_t len = print_format(v, sign, finite, f, g, j, ech, true, dst, 
+        nbytes - 1);
+    dst[len < nbytes ? len : nbytes - 1] = '\0';
+    return len;
+}
+
+// Value classes for batch conversion.
+#define CLASS_GENERAL 0
+#define CLASS_SPECIAL 1
+#define CLASS_ZERO 2
+#define CLASS_SMALL_INT 3
+
+// The number of values that string_many classifies at a time.
+#define MANY_CHUNK 64
+
+// Returns the class of the double with the given bits, without branches, so
+// that a loop over many values can be vectorized by the compiler.
+static inline uint32_t classify(const uint64_t bits) {
+    const uint32_t ieeeExponent = (uint32_t) ((bits >> DOUBLE_MANTISSA_BITS) & 
+        ((1u << DOUBLE_EXPONENT_BITS) - 1));
+    const uint64_t ieeeMantissa = bits & ((1ull << DOUBLE_MANTISSA_BITS) - 1);
+    const uint32_t special = ieeeExponent == (1u << DOUBLE_EXPONENT_BITS) - 1;
+    const uint32_t zero = (bits << 1) == 0;
+    // The same test as d2d_small_int: 1 <= f < 2^53 with no fraction bits.
+    const uint32_t shift = (uint32_t) (DOUBLE_BIAS + DOUBLE_MANTISSA_BITS) - 
+        ieeeExponent;
+    const uint64_t fraction = ieeeMantissa & ((1ull << (shift & 63)) - 1);
+    const uint32_t smallint = (shift <= DOUBLE_MANTISSA_BITS) & 
+        (fraction == 0);
+    return special * CLASS_SPECIAL + zero * CLASS_ZERO + 
+        smallint * CLASS_SMALL_INT;
+}
+
+// Prints the small integer m in fixed-point notation. Returns the length.
+static inline size_t print_small_int(const uint64_t m, const bool sign,
+    char dst[], size_t nbytes)
+{
+    const uint32_t olength = decimalLength17(m);
+    const size_t len = sign + olength;
+    if (len <= nbytes) {
+        dst[0] = '-';
+        write_digits(m, olength, dst + sign);
+        return len;
+    }
+    // Only a part fits, and nbytes < len <= 18.
+    char buf[18];
+    buf[0] = '-';
+    write_digits(m, olength, buf + sign);
+    if (nbytes > 0) {
+        memcpy(dst, buf, nbytes < sizeof(buf) ? nbytes : sizeof(buf));
+    }
+    return len;
+}
+
+// Prints the values into dst, separated by sep, writing no more than nbytes
+// and no null-terminator. NaN and infinities are printed as special, unless
+// it is NULL. Returns the full length of the output.
+static inline size_t print_many(const double values[], size_t count,
+    const bool f, const bool g, const bool j, const char ech, 
+    const char *sep, const char *special, char dst[], size_t nbytes, 
+    size_t lens[])
+{
+    const size_t seplen = sep ? strlen(sep) : 0;
+    const size_t speciallen = special ? strlen(special) : 0;
+    const size_t avail = nbytes;
+    // Small integers are printed directly when the format is known to use
+    // fixed-point notation for them, which 'j' does below 1e21.
+    const bool intfixed = f && (!g || j);
+    size_t total = 0;
+    for (size_t start = 0; start < count; start += MANY_CHUNK) {
+        const size_t n = count - start < MANY_CHUNK ? count - start : 
+            MANY_CHUNK;
+        uint8_t classes[MANY_CHUNK];
+        for (size_t i = 0; i < n; i++) {
+            classes[i] = (uint8_t) classify(double_to_bits(values[start + i]));
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (start + i > 0 && seplen > 0) {
+                const size_t pos = total < avail ? total : avail;
+                total += write_partial(dst + pos, avail - pos, sep, seplen);
+            }
+            const double d = values[start + i];
+            const bool sign = (double_to_bits(d) >> 63) != 0;
+            const size_t pos = total < avail ? total : avail;
+            size_t len;
+            switch (classes[i]) {
+            case CLASS_SPECIAL: 
+                RYU_STAT(special);
+                if (special) {
+                    len = write_partial(dst + pos, avail - pos, special, 
+                        speciallen);
+                } else {
+                    len = write_special(dst + pos, avail - pos, sign, 
+                        (double_to_bits(d) << 12) != 0);
+                }
+                break;
+            case CLASS_ZERO: {
+                RYU_STAT(zero);
+                RYU_STAT_ADD(fixed, g);
+                const char zero[4] = { '-', '0', ech, '0' };
+                len = write_partial(dst + pos, avail - pos, zero + !sign, 
+                    sign + (f ? 1 : 3));
+                break;
+            }
+            case CLASS_SMALL_INT:
+                if (intfixed) {
+                    RYU_STAT(small_int);
+                    RYU_STAT_ADD(fixed, g);
+                    len = print_small_int((uint64_t) (sign ? -d : d), sign, 
+                        dst + pos, avail - pos);
+                    break;
+                }
+                // fall through
+            default: {
+                floating_decimal_64 v;
+                bool s;
+                d2s_decode(d, &s, &v);
+                len = print_format(v, sign, true, f, g, j, ech, true, 
+                    dst + pos, avail - pos);
+            }
+            }
+            if (lens) {
+                lens[start + i] = len;
+            }
+            total += len;
+        }
+    }
+    return total;
+}
+
+static inline size_t string_many(const double values[], size_t count,
+    const bool f, const bool g, const bool j, const char ech, 
+    const char *sep, char dst[], size_t nbytes, size_t lens[])
+{
+    const size_t avail = nbytes > 0 ? nbytes - 1 : 0;
+    RYU_PROFILE_FORMAT(f, g, j, ech);
+    const size_t total = print_many(values, count, f, g, j, ech, sep, NULL, 
+        dst, avail, lens);
+    RYU_PROFILE_FORMAT_END();
+    if (nbytes > 0) {
+        dst[total < avail ? total : avail] = '\0';
+    }
+    return total;
+}
+
+// The most significant digits in the exact decimal expansion of a double.
+#define DOUBLE_MAX_DIGITS 767
+
+// Enough 32-bit limbs for the integer part of a double, or for its binary
+// fraction multiplied by 10^9.
+#define BIG_LIMBS 36
+
+// Writes the 9 digits of digits, less than 10^9, including leading zeros.
+static inline void write_nine_digits(uint32_t digits, char* const result)
+{
+    for (uint32_t i = 0; i < 8; i += 4) {
+        const uint32_t c = digits % 10000;
+        digits /= 10000;
+        const uint32_t c0 = (c % 100) << 1;
+        const uint32_t c1 = (c / 100) << 1;
+        memcpy(result + 7 - i, DIGIT_TABLE + c0, 2);
+        memcpy(result + 5 - i, DIGIT_TABLE + c1, 2);
+    }
+    result[0] = (char) ('0' + digits);
+}
+
+// Writes the 9-digit blocks of the integer m2 * 2^e2, with e2 >= 0, to
+// digits. Returns the number of digits.
+static inline int exact_int_digits(const uint64_t m2, const int32_t e2,
+    char* const digits)
+{
+    uint32_t big[BIG_LIMBS] = { 0 };
+    const int32_t word = e2 / 32;
+    const int32_t bit = e2 % 32;
+    big[word] = (uint32_t) (m2 << bit);
+    big[word + 1] = (uint32_t) ((m2 << bit) >> 32);
+    if (bit > 0) {
+        big[word + 2] = (uint32_t) (m2 >> (64 - bit));
+    }
+    int32_t nlimbs = word + 3;
+    while (nlimbs > 0 && big[nlimbs - 1] == 0) {
+        --nlimbs;
+    }
+    // Divide by 10^9 until nothing is left, least significant block first.
+    uint32_t blocks[BIG_LIMBS];
+    int nblocks = 0;
+    while (nlimbs > 0) {
+        uint64_t rem = 0;
+        for (int32_t i = nlimbs - 1; i >= 0; --i) {
+            const uint64_t x = (rem << 32) | big[i];
+            const uint64_t q = div1e9(x);
+            big[i] = (uint32_t) q;
+            rem = mod1e9(x);
+        }
+        blocks[nblocks++] = (uint32_t) rem;
+        while (nlimbs > 0 && big[nlimbs - 1] == 0) {
+            --nlimbs;
+        }
+    }
+    const uint32_t olength = decimalLength17(blocks[nblocks - 1]);
+    write_digits(blocks[nblocks - 1], olength, digits);
+    int n = (int) olength;
+    for (int i = nblocks - 2; i >= 0; --i) {
+        write_nine_digits(blocks[i], digits + n);
+        n += 9;
+    }
+    return n;
+}
+
+// Computes the exact decimal digits of m2 * 2^e2, with m2 != 0, as
+// 0.ddd * 10^point. Digits stop once enough are known to round to precision
+// digits, after the decimal point if fixed is set, or after the first digit
+// otherwise. Sets sticky when non-zero digits follow the returned ones.
+// Returns the number of digits, which is zero if the value is too small to
+// matter.
+static inline int exact_digits(const uint64_t m2, const int32_t e2, 
+    const bool fixed, const uint32_t precision, char* const digits, 
+    int32_t* const point, bool* const sticky)
+{
+    *sticky = false;
+    if (e2 >= 0) {
+        const int n = exact_int_digits(m2, e2, digits);
+        *point = n;
+        return n;
+    }
+    const int32_t k = -e2;
+    const uint64_t ipart = k < 64 ? m2 >> k : 0;
+    uint32_t big[BIG_LIMBS] = { 0 };
+    const uint64_t fpart = k < 64 ? m2 & ((1ull << k) - 1) : m2;
+    big[0] = (uint32_t) fpart;
+    big[1] = (uint32_t) (fpart >> 32);
+    int n = 0;
+    *point = 0;
+    if (ipart != 0) {
+        n = (int) decimalLength17(ipart);
+        write_digits(ipart, (uint32_t) n, digits);
+        *point = n;
+    }
+    // The binary fraction has k bits. Multiplying it by 10^9 moves the next
+    // nine decimal digits above bit k.
+    const int32_t word = k / 32;
+    const int32_t bit = k % 32;
+    const int32_t nlimbs = word + 2;
+    bool nonzero = fpart != 0;
+    while (nonzero) {
+        const int64_t need = fixed ? (int64_t) *point + precision + 1 : 
+            (int64_t) precision + 2;
+        if (n >= need || n > DOUBLE_MAX_DIGITS) {
+            break;
+        }
+        if (fixed && n == 0 && *point + (int64_t) precision < 0) {
+            // Too small to reach the rounding digit.
+            break;
+        }
+        uint64_t carry = 0;
+        for (int32_t i = 0; i < nlimbs; i++) {
+            const uint64_t x = (uint64_t) big[i] * 1000000000 + carry;
+            big[i] = (uint32_t) x;
+            carry = x >> 32;
+        }
+        uint32_t block = big[word] >> bit;
+        if (bit > 0) {
+            block |= big[word + 1] << (32 - bit);
+        }
+        big[word] &= (1u << bit) - 1;
+        big[word + 1] = 0;
+        nonzero = false;
+        for (int32_t i = 0; i <= word; i++) {
+            nonzero |= big[i] != 0;
+        }
+        if (n == 0) {
+            if (block == 0) {
+                // Leading zeros.
+                *point -= 9;
+                continue;
+            }
+            const uint32_t olength = decimalLength17(block);
+            write_digits(block, olength, digits);
+            *point -= 9 - (int32_t) olength;
+            n = (int) olength;
+        } else {
+            write_nine_digits(block, digits + n);
+            n += 9;
+        }
+    }
+    *sticky = nonzero;
+    return n;
+}
+
+// Rounds the n digits to the first keep digits, half to even. A carry out of
+// the first digit increments point. Returns the number of digits left.
+static inline int round_digits(char* const digits, int n, const int64_t keep,
+    const bool sticky, int32_t* const point)
+{
+    if (keep >= n) {
+        return n;
+    }
+    if (keep < 0) {
+        return 0;
+    }
+    bool rest = sticky;
+    for (int i = (int) keep + 1; i < n && !rest; i++) {
+        rest = digits[i] != '0';
+    }
+    const char next = digits[keep];
+    const bool odd = keep > 0 && ((digits[keep - 1] - '0') & 1) != 0;
+    n = (int) keep;
+    if (next > '5' || (next == '5' && (rest || odd))) {
+        int i = n - 1;
+        while (i >= 0 && digits[i] == '9') {
+            digits[i--] = '0';
+        }
+        if (i >= 0) {
+            digits[i]++;
+        } else {
+            // All nines, e.g. 9.99 became 10.00.
+            digits[0] = '1';
+            n = n > 0 ? n : 1;
+            ++*point;
+        }
+    }
+    return n;
+}
+
+// Appends len bytes from src at *pos in dst, but nothing past nbytes.
+static inline void append_partial(char dst[], size_t nbytes, size_t* pos,
+    const char *src, size_t len)
+{
+    if (*pos < nbytes) {
+        write_partial(dst + *pos, nbytes - *pos, src, len);
+    }
+    *pos += len;
+}
+
+// Appends len zeros at *pos in dst, but nothing past nbytes.
+static inline void append_zeros(char dst[], size_t nbytes, size_t* pos,
+    size_t len)
+{
+    if (*pos < nbytes) {
+        memset(dst + *pos, '0', len < nbytes - *pos ? len : nbytes - *pos);
+    }
+    *pos += len;
+}
+
+// Prints d rounded to precision digits after the decimal point, in fixed
+// notation for 'f' or with a printf style exponent otherwise. Writes no more
+// than nbytes and no null-terminator. Returns the full length of the output.
+static size_t print_precision(double d, const bool fixed, const char ech,
+    const uint32_t precision, char dst[], size_t nbytes)
+{
+    const uint64_t bits = double_to_bits(d);
+    const bool sign = ((bits >> (DOUBLE_MANTISSA_BITS + 
+        DOUBLE_EXPONENT_BITS)) & 1) != 0;
+    const uint64_t ieeeMantissa = bits & ((1ull << DOUBLE_MANTISSA_BITS) - 1);
+    const uint32_t ieeeExponent = (uint32_t) ((bits >> DOUBLE_MANTISSA_BITS) & 
+        ((1u << DOUBLE_EXPONENT_BITS) - 1));
+    if (ieeeExponent == ((1u << DOUBLE_EXPONENT_BITS) - 1u)) {
+        return write_special(dst, nbytes, sign, ieeeMantissa != 0);
+    }
+    int32_t e2;
+    uint64_t m2;
+    if (ieeeExponent == 0) {
+        e2 = 1 - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS;
+        m2 = ieeeMantissa;
+    } else {
+        e2 = (int32_t) ieeeExponent - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS;
+        m2 = (1ull << DOUBLE_MANTISSA_BITS) | ieeeMantissa;
+    }
+
+    char digits[DOUBLE_MAX_DIGITS + 18];
+    int32_t point = 1;
+    int n = 0;
+    if (m2 != 0) {
+        bool sticky;
+        n = exact_digits(m2, e2, fixed, precision, digits, &point, &sticky);
+        const int64_t keep = fixed ? (int64_t) point + precision : 
+            (int64_t) precision + 1;
+        n = round_digits(digits, n, keep, sticky, &point);
+        if (n == 0 && fixed) {
+            point = 1;
+        }
+    }
+
+    size_t pos = 0;
+    if (sign) {
+        append_partial(dst, nbytes, &pos, "-", 1);
+    }
+    if (fixed) {
+        if (point > 0) {
+            const size_t ilength = (size_t) point;
+            const size_t avail = (size_t) n < ilength ? (size_t) n : ilength;
+            append_partial(dst, nbytes, &pos, digits, avail);
+            append_zeros(dst, nbytes, &pos, ilength - avail);
+        } else {
+            append_zeros(dst, nbytes, &pos, 1);
+        }
+        if (precision > 0) {
+            append_partial(dst, nbytes, &pos, ".", 1);
+            size_t left = precision;
+            size_t start = 0;
+            if (point < 0) {
+                // Zeros between the decimal point and the first digit.
+                const size_t zeros = (size_t) -point < left ? 
+                    (size_t) -point : left;
+                append_zeros(dst, nbytes, &pos, zeros);
+                left -= zeros;
+            } else {
+                start = (size_t) point;
+            }
+            if (start < (size_t) n && left > 0) {
+                const size_t count = (size_t) n - start < left ? 
+                    (size_t) n - start : left;
+                append_partial(dst, nbytes, &pos, digits + start, count);
+                left -= count;
+            }
+            append_zeros(dst, nbytes, &pos, left);
+        }
+        return pos;
+    }
+    if (n > 0) {
+        append_partial(dst, nbytes, &pos, digits, 1);
+    } else {
+        append_zeros(dst, nbytes, &pos, 1);
+    }
+    if (precision > 0) {
+        append_partial(dst, nbytes, &pos, ".", 1);
+        const size_t count = n > 1 ? (size_t) n - 1 : 0;
+        append_partial(dst, nbytes, &pos, digits + 1, count);
+        append_zeros(dst, nbytes, &pos, precision - count);
+    }
+    int32_t exp = m2 != 0 ? point - 1 : 0;
+    char buf[5];
+    int index = 0;
+    buf[index++] = ech;
+    if (exp < 0) {
+        buf[index++] = '-';
+        exp = -exp;
+    } else {
+        buf[index++] = '+';
+    }
+    if (exp >= 100) {
+        const int32_t c = exp % 10;
+        memcpy(buf + index, DIGIT_TABLE + 2 * (exp / 10), 2);
+        buf[index + 2] = (char) ('0' + c);
+        index += 3;
+    } else {
+        memcpy(buf + index, DIGIT_TABLE + 2 * exp, 2);
+        index += 2;
+    }
+    append_partial(dst, nbytes, &pos, buf, (size_t) index);
+    return pos;
+}
+
+static size_t string_fmt(const floating_decimal_64 v, const bool sign,
+    const bool finite, char fmt, char dst[], size_t nbytes)
+{
+    switch (fmt) {
+    case 'e':
+        return string_format(v, sign, finite, false, false, false, 'e', dst, 
+            nbytes);
+    case 'E':
+        return string_format(v, sign, finite, false, false, false, 'E', dst, 
+            nbytes);
+    case 'f':
+        return string_format(v, sign, finite, true, false, false, 'e', dst, 
+            nbytes);
+    case 'g':
+        return string_format(v, sign, finite, true, true, false, 'e', dst, 
+            nbytes);
+    case 'G':
+        return string_format(v, sign, finite, true, true, false, 'E', dst, 
+            nbytes);
+    case 'j':
+        return string_format(v, sign, finite, true, true, true, 'e', dst, 
+            nbytes);
+    case 'J':
+        return string_format(v, sign, finite, true, true, true, 'E', dst, 
+            nbytes);
+    default:
+        if (nbytes > 0) {
+            dst[0] = '\0';
+        }
+        return 0;
+    }
+}
+
+// Converts d with the format flags of print_format. Every format's entry
+// point inlines this with constant flags, so that the unused branches are
+// removed from each of them.
+static inline size_t string_double(double d, const bool f, const bool g, 
+    const bool j, const char ech, char dst[], size_t nbytes)
+{
+    RYU_PROFILE_FORMAT(f, g, j, ech);
+    RYU_PROFILE_BEGIN(start);
+    // Small integers use fixed-point notation for 'f' and, below 1e21, for
+    // 'j'. Print them directly, without d2d or removing their zeros.
+    if (f && (!g || j) && classify(double_to_bits(d)) == CLASS_SMALL_INT) {
+        RYU_STAT(small_int);
+        RYU_STAT_ADD(fixed, g);
+        const bool sign = d < 0;
+        const size_t n = nbytes > 0 ? nbytes - 1 : 0;
+        const size_t len = print_small_int((uint64_t) (sign ? -d : d), sign,
+            dst, n);
+        if (nbytes > 0) {
+            dst[len < nbytes ? len : nbytes - 1] = '\0';
+        }
+        RYU_PROFILE_EXIT(start);
+        return len;
+    }
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = d2s_decode(d, &sign, &v);
+    const size_t len = string_format(v, sign, finite, f, g, j, ech, dst, 
+        nbytes);
+    RYU_PROFILE_EXIT(start);
+    return len;
+}
+
+RYU_EXTERN
+size_t ryu_string(double d, char fmt, char dst[], size_t nbytes) {
+    (void)d2s_buffered;
+    switch (fmt) {
+    case 'e':
+        return string_double(d, false, false, false, 'e', dst, nbytes);
+    case 'E':
+        return string_double(d, false, false, false, 'E', dst, nbytes);
+    case 'f':
+        return string_double(d, true, false, false, 'e', dst, nbytes);
+    case 'g':
+        return string_double(d, true, true, false, 'e', dst, nbytes);
+    case 'G':
+        return string_double(d, true, true, false, 'E', dst, nbytes);
+    case 'j':
+        return string_double(d, true, true, true, 'e', dst, nbytes);
+    case 'J':
+        return string_double(d, true, true, true, 'E', dst, nbytes);
+    default:
+        if (nbytes > 0) {
+            dst[0] = '\0';
+        }
+        return 0;
+    }
+}
+
+// Defines the ryu_string_<fmt> entry point for one format.
+#define RYU_STRING_FORMAT(name, f, g, j, ech) \
+RYU_EXTERN \
+size_t name(double d, char dst[], size_t nbytes) { \
+    return string_double(d, f, g, j, ech, dst, nbytes); \
+}
+
+RYU_STRING_FORMAT(ryu_string_e, false, false, false, 'e')
+RYU_STRING_FORMAT(ryu_string_E, false, false, false, 'E')
+RYU_STRING_FORMAT(ryu_string_f, true, false, false, 'e')
+RYU_STRING_FORMAT(ryu_string_g, true, true, false, 'e')
+RYU_STRING_FORMAT(ryu_string_G, true, true, false, 'E')
+RYU_STRING_FORMAT(ryu_string_j, true, true, true, 'e')
+RYU_STRING_FORMAT(ryu_string_J, true, true, true, 'E')
+
+RYU_EXTERN
+size_t ryu_string_f32(float f, char fmt, char dst[], size_t nbytes) {
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = f2s_decode(f, &sign, &v);
+    return string_fmt(v, sign, finite, fmt, dst, nbytes);
+}
+
+RYU_EXTERN
+size_t ryu_string_f16(uint16_t h, char fmt, char dst[], size_t nbytes) {
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = h2s_decode(h, false, &sign, &v);
+    return string_fmt(v, sign, finite, fmt, dst, nbytes);
+}
+
+RYU_EXTERN
+size_t ryu_string_bf16(uint16_t b, char fmt, char dst[], size_t nbytes) {
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = h2s_decode(b, true, &sign, &v);
+    return string_fmt(v, sign, finite, fmt, dst, nbytes);
+}
+
+#ifndef RYU_VALUE_DEFINED
+#define RYU_VALUE_DEFINED
+// A double, or a float, decoded into its shortest decimal representation.
+// The fields are private, use the ryu_value_* functions.
+struct ryu_value {
+    uint64_t mantissa;
+    int32_t exponent;
+    bool sign;
+    bool finite;
+};
+#endif
+
+// Unpacks a ryu_value into the decoded form used by the formatters.
+static inline floating_decimal_64 value_decimal(const struct ryu_value* v) {
+    floating_decimal_64 fd;
+    fd.mantissa = v->mantissa;
+    fd.exponent = v->exponent;
+    return fd;
+}
+
+static inline struct ryu_value decimal_value(const floating_decimal_64 fd,
+    const bool sign, const bool finite)
+{
+    struct ryu_value v;
+    v.mantissa = fd.mantissa;
+    v.exponent = fd.exponent;
+    v.sign = sign;
+    v.finite = finite;
+    return v;
+}
+
+RYU_EXTERN
+struct ryu_value ryu_decode(double d) {
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = d2s_decode(d, &sign, &v);
+    return decimal_value(v, sign, finite);
+}
+
+RYU_EXTERN
+struct ryu_value ryu_decode_f32(float f) {
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = f2s_decode(f, &sign, &v);
+    return decimal_value(v, sign, finite);
+}
+
+RYU_EXTERN
+struct ryu_value ryu_decode_f16(uint16_t h) {
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = h2s_decode(h, false, &sign, &v);
+    return decimal_value(v, sign, finite);
+}
+
+RYU_EXTERN
+struct ryu_value ryu_decode_bf16(uint16_t b) {
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = h2s_decode(b, true, &sign, &v);
+    return decimal_value(v, sign, finite);
+}
+
+RYU_EXTERN
+size_t ryu_value_length(struct ryu_value v, char fmt) {
+    return string_fmt(value_decimal(&v), v.sign, v.finite, fmt, NULL, 0);
+}
+
+RYU_EXTERN
+size_t ryu_value_string(struct ryu_value v, char fmt, char dst[], 
+    size_t nbytes)
+{
+    return string_fmt(value_decimal(&v), v.sign, v.finite, fmt, dst, nbytes);
+}
+
+RYU_EXTERN
+size_t ryu_length(double d, char fmt) {
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = d2s_decode(d, &sign, &v);
+    return string_fmt(v, sign, finite, fmt, NULL, 0);
+}
+
+RYU_EXTERN
+bool ryu_decompose(double d, uint64_t *mantissa, int32_t *exponent, 
+    bool *sign)
+{
+    floating_decimal_64 v;
+    const bool finite = d2s_decode(d, sign, &v);
+    *mantissa = v.mantissa;
+    *exponent = v.exponent;
+    return finite;
+}
+
+#ifndef RYU_WRITER_DEFINED
+#define RYU_WRITER_DEFINED
+// A streaming writer that appends into the caller-owned buffer buf, which
+// holds cap bytes, of which the first len are written.
+struct ryu_writer {
+    char *buf;
+    size_t cap;
+    size_t len;
+    // Called when the next write of need bytes does not fit. It should make
+    // room, by growing buf and cap, or by consuming buf and resetting len.
+    // Returns false to fail the write. May be NULL.
+    bool (*flush)(struct ryu_writer *w, size_t need);
+    // Caller data for flush, not used by ryu.
+    void *udata;
+};
+#endif
+
+// Makes room for n more bytes in w, flushing if needed.
+static inline bool writer_reserve(struct ryu_writer* w, size_t n) {
+    if (w->cap - w->len >= n) {
+        return true;
+    }
+    if (!w->flush || !w->flush(w, n)) {
+        return false;
+    }
+    return w->cap - w->len >= n;
+}
+
+static inline size_t writer_format(struct ryu_writer* w, double d,
+    const bool f, const bool g, const bool j, const char ech)
+{
+    RYU_PROFILE_FORMAT(f, g, j, ech);
+    RYU_PROFILE_BEGIN(start);
+    if (f && (!g || j) && classify(double_to_bits(d)) == CLASS_SMALL_INT) {
+        RYU_STAT(small_int);
+        RYU_STAT_ADD(fixed, g);
+        const bool sign = d < 0;
+        const uint64_t m = (uint64_t) (sign ? -d : d);
+        const size_t len = sign + decimalLength17(m);
+        if (!writer_reserve(w, len)) {
+            RYU_PROFILE_EXIT(start);
+            return 0;
+        }
+        print_small_int(m, sign, w->buf + w->len, len);
+        w->len += len;
+        RYU_PROFILE_EXIT(start);
+        return len;
+    }
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = d2s_decode(d, &sign, &v);
+    const size_t len = print_format(v, sign, finite, f, g, j, ech, true, 
+        NULL, 0);
+    if (!writer_reserve(w, len)) {
+        RYU_PROFILE_EXIT(start);
+        return 0;
+    }
+    print_format(v, sign, finite, f, g, j, ech, false, w->buf + w->len, len);
+    w->len += len;
+    RYU_PROFILE_EXIT(start);
+    return len;
+}
+
+RYU_EXTERN
+size_t ryu_write_double(struct ryu_writer *w, double d, char fmt) {
+    switch (fmt) {
+    case 'e':
+        return writer_format(w, d, false, false, false, 'e');
+    case 'E':
+        return writer_format(w, d, false, false, false, 'E');
+    case 'f':
+        return writer_format(w, d, true, false, false, 'e');
+    case 'g':
+        return writer_format(w, d, true, true, false, 'e');
+    case 'G':
+        return writer_format(w, d, true, true, false, 'E');
+    case 'j':
+        return writer_format(w, d, true, true, true, 'e');
+    case 'J':
+        return writer_format(w, d, true, true, true, 'E');
+    default:
+        return 0;
+    }
+}
+
+RYU_EXTERN
+size_t ryu_write_bytes(struct ryu_writer *w, const char *src, size_t len) {
+    if (!writer_reserve(w, len)) {
+        return 0;
+    }
+    if (len > 0) {
+        memcpy(w->buf + w->len, src, len);
+    }
+    w->len += len;
+    return len;
+}
+
+RYU_EXTERN
+size_t ryu_string_precision(double d, char fmt, unsigned precision, 
+    char dst[], size_t nbytes)
+{
+    size_t len = 0;
+    const size_t n = nbytes > 0 ? nbytes - 1 : 0;
+    switch (fmt) {
+    case 'e':
+        len = print_precision(d, false, 'e', precision, dst, n);
+        break;
+    case 'E':
+        len = print_precision(d, false, 'E', precision, dst, n);
+        break;
+    case 'f':
+        len = print_precision(d, true, 'e', precision, dst, n);
+        break;
+    }
+    if (nbytes > 0) {
+        dst[len < nbytes ? len : nbytes - 1] = '\0';
+    }
+    return len;
+}
+
+RYU_EXTERN
+size_t ryu_string_many(const double values[], size_t count, char fmt, 
+    const char *sep, char dst[], size_t nbytes, size_t lens[])
+{
+    // The format is resolved once for the whole batch.
+    switch (fmt) {
+    case 'e':
+        return string_many(values, count, false, false, false, 'e', sep, 
+            dst, nbytes, lens);
+    case 'E':
+        return string_many(values, count, false, false, false, 'E', sep, 
+            dst, nbytes, lens);
+    case 'f':
+        return string_many(values, count, true, false, false, 'e', sep, 
+            dst, nbytes, lens);
+    case 'g':
+        return string_many(values, count, true, true, false, 'e', sep, 
+            dst, nbytes, lens);
+    case 'G':
+        return string_many(values, count, true, true, false, 'E', sep, 
+            dst, nbytes, lens);
+    case 'j':
+        return string_many(values, count, true, true, true, 'e', sep, 
+            dst, nbytes, lens);
+    case 'J':
+        return string_many(values, count, true, true, true, 'E', sep, 
+            dst, nbytes, lens);
+    default:
+        if (lens) {
+            memset(lens, 0, count * sizeof(size_t));
+        }
+        if (nbytes > 0) {
+            dst[0] = '\0';
+        }
+        return 0;
+    }
+}
+
+RYU_EXTERN
+size_t ryu_json_array(const double values[], size_t count, 
+    const char *special, char dst[], size_t nbytes)
+{
+    const size_t avail = nbytes > 0 ? nbytes - 1 : 0;
+    size_t total = write_partial(dst, avail, "[", 1);
+    const size_t pos = total < avail ? total : avail;
+    total += print_many(values, count, true, true, true, 'e', ",", 
+        special ? special : "null", dst + pos, avail - pos, NULL);
+    const size_t end = total < avail ? total : avail;
+    total += write_partial(dst + end, avail - end, "]", 1);
+    if (nbytes > 0) {
+        dst[total < avail ? total : avail] = '\0';
+    }
+    return total;
+}
+
+RYU_EXTERN
+size_t ryu_csv_row(const double values[], size_t count, char sep,
+    const char *special, char dst[], size_t nbytes)
+{
+    const char sepstr[2] = { sep, '\0' };
+    const size_t avail = nbytes > 0 ? nbytes - 1 : 0;
+    const size_t total = print_many(values, count, true, true, true, 'e', 
+        sepstr, special, dst, avail, NULL);
+    if (nbytes > 0) {
+        dst[total < avail ? total : avail] = '\0';
+    }
+    return total;
+}
+
+#ifndef RYU_OPTIONS_DEFINED
+#define RYU_OPTIONS_DEFINED
+// Options for ryu_string_options. A zeroed struct is the 'j' format.
+struct ryu_options {
+    // One of the ryu_string formats, or 'j' when zero.
+    char format;
+    // The decimal point, or '.' when zero.
+    char point;
+    // The exponent character, or the case of the format when zero.
+    char exponent;
+    // '+' to sign every exponent, '-' to sign only negative exponents, or
+    // the sign of the format when zero.
+    char exponent_sign;
+    // Suffix integral outputs without an exponent with ".0", as in "5.0".
+    bool dotzero;
+    // The outputs for NaN and infinities, or "NaN", "Infinity" and
+    // "-Infinity" when NULL.
+    const char *nan;
+    const char *infinity;
+    const char *neg_infinity;
+};
+#endif
+
+// A struct ryu_options resolved into the arguments of print_options.
+struct options {
+    bool f, g, j, plus, dotzero;
+    char ech, point;
+    const char *special[3];
+    size_t speciallen[3];
+};
+
+// Resolves opts, which may be NULL, into o. Returns false if the format is
+// invalid.
+static bool resolve_options(const struct ryu_options *opts, 
+    struct options *o)
+{
+    static const struct ryu_options defaults = { 0 };
+    if (!opts) {
+        opts = &defaults;
+    }
+    const char fmt = opts->format ? opts->format : 'j';
+    if (!strchr("eEfgGjJ", fmt)) {
+        return false;
+    }
+    o->f = fmt != 'e' && fmt != 'E';
+    o->j = fmt == 'j' || fmt == 'J';
+    o->g = fmt == 'g' || fmt == 'G' || o->j;
+    const bool upper = fmt == 'E' || fmt == 'G' || fmt == 'J';
+    o->ech = opts->exponent ? opts->exponent : upper ? 'E' : 'e';
+    o->plus = opts->exponent_sign ? opts->exponent_sign == '+' : o->j;
+    o->point = opts->point ? opts->point : '.';
+    o->dotzero = opts->dotzero;
+    o->special[0] = opts->nan ? opts->nan : "NaN";
+    o->special[1] = opts->infinity ? opts->infinity : "Infinity";
+    o->special[2] = opts->neg_infinity ? opts->neg_infinity : "-Infinity";
+    for (int i = 0; i < 3; i++) {
+        o->speciallen[i] = strlen(o->special[i]);
+    }
+    return true;
+}
+
+// Prints the decoded value v with the resolved options o, like
+// print_format.
+static inline size_t print_resolved(const floating_decimal_64 v, 
+    const bool sign, const bool finite, const struct options *o, 
+    char dst[], size_t nbytes)
+{
+    if (!finite) {
+        const int i = v.mantissa != 0 ? 0 : sign ? 2 : 1;
+        return write_partial(dst, nbytes, o->special[i], o->speciallen[i]);
+    }
+    return print_options(v, sign, o->f, o->g, o->j, o->ech, o->plus, 
+        o->point, o->dotzero, true, dst, nbytes);
+}
+
+// Converts d with the resolved options o.
+static inline size_t print_double(double d, const struct options *o, 
+    char dst[], size_t nbytes)
+{
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = d2s_decode(d, &sign, &v);
+    return print_resolved(v, sign, finite, o, dst, nbytes);
+}
+
+RYU_EXTERN
+size_t ryu_string_options(double d, const struct ryu_options *opts, 
+    char dst[], size_t nbytes)
+{
+    struct options o;
+    size_t len = 0;
+    if (resolve_options(opts, &o)) {
+        len = print_double(d, &o, dst, nbytes > 0 ? nbytes - 1 : 0);
+    }
+    if (nbytes > 0) {
+        dst[len < nbytes ? len : nbytes - 1] = '\0';
+    }
+    return len;
+}
+
+RYU_EXTERN
+size_t ryu_string_many_options(const double values[], size_t count, 
+    const struct ryu_options *opts, const char *sep, char dst[], 
+    size_t nbytes, size_t lens[])
+{
+    struct options o;
+    if (!resolve_options(opts, &o)) {
+        return ryu_string_many(values, count, opts->format, sep, dst, nbytes,
+            lens);
+    }
+    const size_t seplen = sep ? strlen(sep) : 0;
+    const size_t avail = nbytes > 0 ? nbytes - 1 : 0;
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0 && seplen > 0) {
+            const size_t pos = total < avail ? total : avail;
+            total += write_partial(dst + pos, avail - pos, sep, seplen);
+        }
+        const size_t pos = total < avail ? total : avail;
+        const size_t len = print_double(values[i], &o, dst + pos, 
+            avail - pos);
+        if (lens) {
+            lens[i] = len;
+        }
+        total += len;
+    }
+    if (nbytes > 0) {
+        dst[total < avail ? total : avail] = '\0';
+    }
+    return total;
+}
+
+// Prints the fp16 values, or the bfloat16 values if bfloat is set, like
+// ryu_string_many.
+static inline size_t string_many_16(const uint16_t values[], size_t count, 
+    const bool bfloat, char fmt, const char *sep, char dst[], size_t nbytes,
+    size_t lens[])
+{
+    const struct ryu_options opts = { .format = fmt };
+    struct options o;
+    if (fmt == 0 || !resolve_options(&opts, &o)) {
+        if (lens) {
+            memset(lens, 0, count * sizeof(size_t));
+        }
+        if (nbytes > 0) {
+            dst[0] = '\0';
+        }
+        return 0;
+    }
+    const size_t seplen = sep ? strlen(sep) : 0;
+    const size_t avail = nbytes > 0 ? nbytes - 1 : 0;
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0 && seplen > 0) {
+            const size_t pos = total < avail ? total : avail;
+            total += write_partial(dst + pos, avail - pos, sep, seplen);
+        }
+        bool sign;
+        floating_decimal_64 v;
+        const bool finite = h2s_decode(values[i], bfloat, &sign, &v);
+        const size_t pos = total < avail ? total : avail;
+        const size_t len = print_resolved(v, sign, finite, &o, dst + pos, 
+            avail - pos);
+        if (lens) {
+            lens[i] = len;
+        }
+        total += len;
+    }
+    if (nbytes > 0) {
+        dst[total < avail ? total : avail] = '\0';
+    }
+    return total;
+}
+
+RYU_EXTERN
+size_t ryu_string_many_f16(const uint16_t values[], size_t count, char fmt,
+    const char *sep, char dst[], size_t nbytes, size_t lens[])
+{
+    return string_many_16(values, count, false, fmt, sep, dst, nbytes, lens);
+}
+
+RYU_EXTERN
+size_t ryu_string_many_bf16(const uint16_t values[], size_t count, char fmt,
+    const char *sep, char dst[], size_t nbytes, size_t lens[])
+{
+    return string_many_16(values, count, true, fmt, sep, dst, nbytes, lens);
+}
+
+// The longest integer output: a sign and 20 digits.
+#define INT_MAX_LENGTH 21
+
+static inline uint32_t decimalLength20(const uint64_t v) {
+    if (v < 100000000000000000u) {
+        return decimalLength17(v);
+    }
+    return 18 + (v >= 1000000000000000000u) + (v >= 10000000000000000000u);
+}
+
+// Prints the integer m, negated when sign is set, with the digit kernel of
+// to_chars. Writes no more than nbytes and no null-terminator, and returns
+// the full length.
+static inline size_t print_int(const uint64_t m, const bool sign, 
+    char dst[], size_t nbytes)
+{
+    if (m < 100000000000000000u) {
+        return print_small_int(m, sign, dst, nbytes);
+    }
+    // Split off the last 9 digits, so that at most 11 are left for
+    // write_digits.
+    const uint64_t q = div1e9(m);
+    const uint32_t olength = decimalLength20(m);
+    const size_t len = sign + olength;
+    char buf[INT_MAX_LENGTH];
+    char *p = len <= nbytes ? dst : buf;
+    p[0] = '-';
+    write_digits(q, olength - 9, p + sign);
+    write_nine_digits(mod1e9(m), p + len - 9);
+    if (p == buf && nbytes > 0) {
+        memcpy(dst, buf, nbytes);
+    }
+    return len;
+}
+
+static inline size_t string_int(const uint64_t m, const bool sign, 
+    char dst[], size_t nbytes)
+{
+    const size_t len = print_int(m, sign, dst, nbytes > 0 ? nbytes - 1 : 0);
+    if (nbytes > 0) {
+        dst[len < nbytes ? len : nbytes - 1] = '\0';
+    }
+    return len;
+}
+
+// Prints the unsigned values u, or the signed values s when u is NULL, like
+// string_many.
+static inline size_t string_ints(const uint64_t u[], const int64_t s[], 
+    size_t count, const char *sep, char dst[], size_t nbytes, size_t lens[])
+{
+    const size_t seplen = sep ? strlen(sep) : 0;
+    const size_t avail = nbytes > 0 ? nbytes - 1 : 0;
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0 && seplen > 0) {
+            const size_t pos = total < avail ? total : avail;
+            total += write_partial(dst + pos, avail - pos, sep, seplen);
+        }
+        const bool sign = !u && s[i] < 0;
+        const uint64_t m = u ? u[i] : 
+            sign ? 0 - (uint64_t) s[i] : (uint64_t) s[i];
+        const size_t pos = total < avail ? total : avail;
+        const size_t len = print_int(m, sign, dst + pos, avail - pos);
+        if (lens) {
+            lens[i] = len;
+        }
+        total += len;
+    }
+    if (nbytes > 0) {
+        dst[total < avail ? total : avail] = '\0';
+    }
+    return total;
+}
+
+static inline size_t writer_int(struct ryu_writer* w, const uint64_t m,
+    const bool sign)
+{
+    const size_t len = sign + decimalLength20(m);
+    if (!writer_reserve(w, len)) {
+        return 0;
+    }
+    print_int(m, sign, w->buf + w->len, len);
+    w->len += len;
+    return len;
+}
+
+RYU_EXTERN
+size_t ryu_u64(uint64_t v, char dst[], size_t nbytes) {
+    return string_int(v, false, dst, nbytes);
+}
+
+RYU_EXTERN
+size_t ryu_i64(int64_t v, char dst[], size_t nbytes) {
+    return string_int(v < 0 ? 0 - (uint64_t) v : (uint64_t) v, v < 0, dst, 
+        nbytes);
+}
+
+RYU_EXTERN
+size_t ryu_u64_many(const uint64_t values[], size_t count, const char *sep,
+    char dst[], size_t nbytes, size_t lens[])
+{
+    return string_ints(values, NULL, count, sep, dst, nbytes, lens);
+}
+
+RYU_EXTERN
+size_t ryu_i64_many(const int64_t values[], size_t count, const char *sep,
+    char dst[], size_t nbytes, size_t lens[])
+{
+    return string_ints(NULL, values, count, sep, dst, nbytes, lens);
+}
+
+RYU_EXTERN
+size_t ryu_write_u64(struct ryu_writer *w, uint64_t v) {
+    return writer_int(w, v, false);
+}
+
+RYU_EXTERN
+size_t ryu_write_i64(struct ryu_writer *w, int64_t v) {
+    return writer_int(w, v < 0 ? 0 - (uint64_t) v : (uint64_t) v, v < 0);
+}
+
+#ifndef RYU_SERIES_DEFINED
+#define RYU_SERIES_DEFINED
+// The longest output that a ryu_series keeps for the next value.
+#define RYU_SERIES_TEXT 32
+
+// The state of ryu_series_string, for the consecutive values of one series.
+// A zeroed struct, with the format set, starts a new series. The other
+// fields are internal.
+struct ryu_series {
+    // One of the ryu_string formats, or 'j' when zero.
+    char fmt;
+    // The previous value and its output, which is kept when it fits in text,
+    // and the format it was printed in.
+    bool cached;
+    char textfmt;
+    bool sign;
+    // The number of digits of mantissa, or 0 when they can't be rewritten.
+    uint8_t olength;
+    // The digits are at start, with the decimal point after split of them.
+    uint8_t start;
+    uint8_t split;
+    uint8_t len;
+    int32_t exponent;
+    uint64_t bits;
+    uint64_t mantissa;
+    char text[RYU_SERIES_TEXT];
+};
+#endif
+
+// Returns the flags of the format fmt, with zero as 'j', or false if it is
+// not a format.
+static inline bool format_flags(const char fmt, bool* const f, bool* const g,
+    bool* const j, char* const ech)
+{
+    switch (fmt) {
+    case 'e': case 'E':
+        *f = false, *g = false, *j = false;
+        break;
+    case 'f':
+        *f = true, *g = false, *j = false;
+        break;
+    case 'g': case 'G':
+        *f = true, *g = true, *j = false;
+        break;
+    case '\0': case 'j': case 'J':
+        *f = true, *g = true, *j = true;
+        break;
+    default:
+        return false;
+    }
+    *ech = fmt == 'E' || fmt == 'G' || fmt == 'J' ? 'E' : 'e';
+    return true;
+}
+
+// The most low digits that series_print rewrites one at a time, as a power
+// of ten.
+#define SERIES_REWRITE_POW10 10000
+
+// Copies n bytes, no more than 32, with two fixed-size copies that may
+// overlap. The compilers expand a copy of a variable size into a loop or
+// "rep movs", which is slow for a few bytes.
+static inline void copy_short(char* const dst, const char* const src,
+    const size_t n)
+{
+    if (n >= 16) {
+        memcpy(dst, src, 16);
+        memcpy(dst + n - 16, src + n - 16, 16);
+    } else if (n >= 8) {
+        memcpy(dst, src, 8);
+        memcpy(dst + n - 8, src + n - 8, 8);
+    } else if (n >= 4) {
+        memcpy(dst, src, 4);
+        memcpy(dst + n - 4, src + n - 4, 4);
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = src[i];
+        }
+    }
+}
+
+// Copies the output kept in s to dst, like write_partial.
+static inline size_t series_copy(const struct ryu_series* s, char dst[], 
+    const size_t nbytes)
+{
+    copy_short(dst, s->text, s->len < nbytes ? s->len : nbytes);
+    return s->len;
+}
+
+// Prints the next value d of the series s like print_format. Consecutive
+// values of a series often have the same bits, or the same sign, exponent
+// and number of digits and the same high digits, and then the output of the
+// previous value is reused, with only the low digits that changed
+// rewritten. The output is kept in s->text only when the next value looks
+// like it can reuse it, so that series that change too much pay for no
+// more than a sign and exponent comparison.
+static size_t series_print(struct ryu_series* s, const double d, 
+    const bool f, const bool g, const bool j, const char ech, char dst[], 
+    size_t nbytes)
+{
+    const uint64_t bits = double_to_bits(d);
+    // The text of another format can't be reused or rewritten.
+    s->cached = s->cached && s->textfmt == s->fmt;
+    if (s->cached && bits == s->bits) {
+        return series_copy(s, dst, nbytes);
+    }
+    bool sign;
+    floating_decimal_64 v;
+    const bool finite = d2s_decode(d, &sign, &v);
+    const uint32_t olength = decimalLength17(v.mantissa);
+    uint64_t a = v.mantissa;
+    uint64_t b = s->mantissa;
+    const bool near = bits == s->bits || (finite && s->olength == olength && 
+        s->sign == sign && s->exponent == v.exponent && 
+        a / SERIES_REWRITE_POW10 == b / SERIES_REWRITE_POW10);
+    s->bits = bits;
+    s->sign = sign;
+    s->exponent = v.exponent;
+    s->mantissa = v.mantissa;
+    if (near && s->cached) {
+        // Rewrite the low digits until the rest of the two mantissas are
+        // the same.
+        series_copy(s, dst, nbytes);
+        for (uint32_t i = olength; a != b; a /= 10, b /= 10) {
+            i--;
+            const uint32_t pos = s->start + i + (i >= s->split);
+            s->text[pos] = (char) ('0' + a % 10);
+            if (pos < nbytes) {
+                dst[pos] = s->text[pos];
+            }
+        }
+        return s->len;
+    }
+    const size_t len = print_format(v, sign, finite, f, g, j, ech, true, dst, 
+        nbytes);
+    s->olength = (uint8_t) olength;
+    s->cached = near && len <= RYU_SERIES_TEXT;
+    if (!s->cached) {
+        return len;
+    }
+    // Print the output again instead of copying it from dst, as reading it
+    // right after it was written is slower.
+    print_format(v, sign, finite, f, g, j, ech, false, s->text, len);
+    s->textfmt = s->fmt;
+    s->len = (uint8_t) len;
+    // Find where the digits are, like print_options and to_chars_fixed. Only
+    // the exponent form has the exponent character.
+    const int32_t exp = v.exponent + (int32_t) olength - 1;
+    const bool fixed = f && (!g || memchr(s->text, ech, len) == NULL);
+    s->start = (uint8_t) sign;
+    s->split = (uint8_t) olength;
+    if (!finite || (fixed && exp + 2 == (int32_t) olength)) {
+        // A lone trailing zero would be dropped, changing the layout.
+        s->olength = 0;
+    } else if (!fixed) {
+        s->split = 1;
+    } else if (exp < 0) {
+        s->start = (uint8_t) (sign + 1 - exp);
+    } else if (exp + 1 < (int32_t) olength) {
+        s->split = (uint8_t) (exp + 1);
+    }
+    return len;
+}
+
+RYU_EXTERN
+size_t ryu_series_string(struct ryu_series *s, double d, char dst[], 
+    size_t nbytes)
+{
+    bool f, g, j;
+    char ech;
+    if (!format_flags(s->fmt, &f, &g, &j, &ech)) {
+        if (nbytes > 0) {
+            dst[0] = '\0';
+        }
+        return 0;
+    }
+    const size_t len = series_print(s, d, f, g, j, ech, dst, 
+        nbytes > 0 ? nbytes - 1 : 0);
+    if (nbytes > 0) {
+        dst[len < nbytes ? len : nbytes - 1] = '\0';
+    }
+    return len;
+}
+
+RYU_EXTERN
+size_t ryu_write_series(struct ryu_writer *w, struct ryu_series *s, double d)
+{
+    bool f, g, j;
+    char ech;
+    if (!format_flags(s->fmt, &f, &g, &j, &ech)) {
+        return 0;
+    }
+    if (w->cap - w->len >= RYU_SERIES_TEXT) {
+        // Print in place, which fits unless the output is too long to keep.
+        const size_t len = series_print(s, d, f, g, j, ech, w->buf + w->len, 
+            RYU_SERIES_TEXT);
+        if (len <= RYU_SERIES_TEXT) {
+            w->len += len;
+            return len;
+        }
+        return ryu_write_double(w, d, s->fmt ? s->fmt : 'j');
+    }
+    const size_t len = series_print(s, d, f, g, j, ech, NULL, 0);
+    if (!s->cached) {
+        return ryu_write_double(w, d, s->fmt ? s->fmt : 'j');
+    }
+    return ryu_write_bytes(w, s->text, len);
+}
+
+// Long double and binary128 values are converted by Ryu on 128-bit
+// mantissas, with 249-bit powers of 5. This needs a 128-bit integer, which is
+// used here even with RYU_ONLY_64_BIT_OPS.
+#if defined(__SIZEOF_INT128__) && !defined(_MSC_VER)
+#define HAS_GENERIC_128
+#endif
+
+// A long double that is a double uses the double path. The 80-bit x87 format
+// and IEEE binary128 use the generic one.
+#if LDBL_MANT_DIG == 53 || (defined(HAS_GENERIC_128) && \
+    ((LDBL_MANT_DIG == 64 && (defined(__i386__) || defined(__x86_64__))) || \
+    LDBL_MANT_DIG == 113))
+#define HAS_LONG_DOUBLE
+#endif
+
+#if defined(HAS_GENERIC_128)
+
+#if !defined(HAS_UINT128)
+typedef __uint128_t uint128_t;
+#endif
+
+#define GENERIC_POW5_BITCOUNT 249
+#define GENERIC_POW5_INV_BITCOUNT 249
+#define GENERIC_EXPONENT_BITS 15
+#define GENERIC_BIAS 16383
+
+// These tables are generated like the RYU_OPTIMIZE_SIZE ones, with every
+// 56th power of 5 and 2-bit corrections, and cover the 15-bit exponents of
+// both formats.
+#define GENERIC_POW5_TABLE_SIZE 56
+
+static const uint64_t GENERIC_POW5_TABLE[GENERIC_POW5_TABLE_SIZE][2] = {
+    {                    1u,                    0u },
+    {                    5u,                    0u },
+    {                   25u,                    0u },
+    {                  125u,                    0u },
+    {                  625u,                    0u },
+    {                 3125u,                    0u },
+    {                15625u,                    0u },
+    {                78125u,                    0u },
+    {               390625u,                    0u },
+    {              1953125u,                    0u },
+    {              9765625u,                    0u },
+    {             48828125u,                    0u },
+    {            244140625u,                    0u },
+    {           1220703125u,                    0u },
+    {           6103515625u,                    0u },
+    {          30517578125u,                    0u },
+    {         152587890625u,                    0u },
+    {         762939453125u,                    0u },
+    {        3814697265625u,                    0u },
+    {       19073486328125u,                    0u },
+    {       95367431640625u,                    0u },
+    {      476837158203125u,                    0u },
+    {     2384185791015625u,                    0u },
+    {    11920928955078125u,                    0u },
+    {    59604644775390625u,                    0u },
+    {   298023223876953125u,                    0u },
+    {  1490116119384765625u,                    0u },
+    {  7450580596923828125u,                    0u },
+    {   359414837200037393u,                    2u },
+    {  1797074186000186965u,                   10u },
+    {  8985370930000934825u,                   50u },
+    {  8033366502585570893u,                  252u },
+    {  3273344365508751233u,                 1262u },
+    { 16366721827543756165u,                 6310u },
+    {  8046632842880574361u,                31554u },
+    {  3339676066983768573u,               157772u },
+    { 16698380334918842865u,               788860u },
+    {  9704925379756007861u,              3944304u },
+    { 11631138751360936073u,             19721522u },
+    {  2815461535676025517u,             98607613u },
+    { 14077307678380127585u,            493038065u },
+    { 15046306170771983077u,           2465190328u },
+    {  1444554559021708921u,          12325951644u },
+    {  7222772795108544605u,          61629758220u },
+    { 17667119901833171409u,         308148791101u },
+    { 14548623214327650581u,        1540743955509u },
+    { 17402883850509598057u,        7703719777548u },
+    { 13227442957709783821u,       38518598887744u },
+    { 10796982567420264257u,      192592994438723u },
+    { 17091424689682218053u,      962964972193617u },
+    { 11670147153572883801u,     4814824860968089u },
+    {  3010503546735764157u,    24074124304840448u },
+    { 15052517733678820785u,   120370621524202240u },
+    {  1475612373555897461u,   601853107621011204u },
+    {  7378061867779487305u,  3009265538105056020u },
+    { 18443565265187884909u, 15046327690525280101u }
+};
+
+static const uint64_t GENERIC_POW5_SPLIT[89][4] = {
+    {                    0u,                    0u,
+                         0u,    72057594037927936u },
+    {                    0u,  5206161169240293376u,
+       4575641699882439235u,    73468396926392969u },
+    {  3360510775605221349u,  6983200512169538081u,
+       4325643253124434363u,    74906821675075173u },
+    { 11917660854915489451u,  9652941469841108803u,
+        946308467778435600u,    76373409087490117u },
+    {  1994853395185689235u, 16102657350889591545u,
+       6847013871814915412u,    77868710555449746u },
+    {   958415760277438274u, 15059347134713823592u,
+       7329070255463483331u,    79393288266368765u },
+    {  2065144883315240188u,  7145278325844925976u,
+      14718454754511147343u,    80947715414629833u },
+    {  8980391188862868935u, 13709057401304208685u,
+       8230434828742694591u,    82532576417087045u },
+    {   432148644612782575u,  7960151582448466064u,
+      12056089168559840552u,    84148467132788711u },
+    {   484109300864744403u, 15010663910730448582u,
+      16824949663447227068u,    85795995087002057u },
+    { 14793711725276144220u, 16494403799991899904u,
+      10145107106505865967u,    87475779699624060u },
+    { 15427548291869817042u, 12330588654550505203u,
+      13980791795114552342u,    89188452518064298u },
+    {  9979404135116626552u, 13477446383271537499u,
+      14459862802511591337u,    90934657454687378u },
+    { 12385121150303452775u,  9097130814231585614u,
+       6523855782339765207u,    92715051028904201u },
+    {  1822931022538209743u, 16062974719797586441u,
+       3619180286173516788u,    94530302614003091u },
+    { 12318611738248470829u, 13330752208259324507u,
+      10986694768744162601u,    96381094688813589u },
+    { 13684493829640282333u,  7674802078297225834u,
+      15208116197624593182u,    98268123094297527u },
+    {  5408877057066295332u,  6470124174091971006u,
+      15112713923117703147u,   100192097295163851u },
+    { 11407083166564425062u, 18189998238742408185u,
+       4337638702446708282u,   102153740646605557u },
+    {  4112405898036935485u,   924624216579956435u,
+      14251108172073737125u,   104153790666259019u },
+    { 16996739107011444789u, 10015944118339042475u,
+       2395188869672266257u,   106192999311487969u },
+    {  4588314690421337879u,  5339991768263654604u,
+      15441007590670620066u,   108272133262096356u },
+    {  2286159977890359825u, 14329706763185060248u,
+       5980012964059367667u,   110391974208576409u },
+    {  9654767503237031099u, 11293544302844823188u,
+      11739932712678287805u,   112553319146000238u },
+    { 11362964448496095896u,  7990659682315657680u,
+        251480263940996374u,   114756980673665505u },
+    {  1423410421096377129u, 14274395557581462179u,
+      16553482793602208894u,   117003787300607788u },
+    {  2070444190619093137u, 11517140404712147401u,
+      11657844572835578076u,   119294583757094535u },
+    {  7648316884775828921u, 15264332483297977688u,
+        247182277434709002u,   121630231312217685u },
+    { 17410896758132241352u, 10923914482914417070u,
+      13976383996795783649u,   124011608097704390u },
+    {  9542674537907272703u,  3079432708831728956u,
+      14235189590642919676u,   126439609438067572u },
+    { 10364666969937261816u,  8464573184892924210u,
+      12758646866025101190u,   128915148187220428u },
+    { 14720354822146013883u, 11480204489231511423u,
+       7449876034836187038u,   131439155071681461u },
+    {  1692907053653558553u, 17835392458598425233u,
+       1754856712536736598u,   134012579040499057u },
+    {  5620591334531458755u, 11361776175667106627u,
+      13350215315297937856u,   136636387622027174u },
+    { 17455759733928092601u, 10362573084069962561u,
+      11246018728801810510u,   139311567287686283u },
+    {  2465404073814044982u, 17694822665274381860u,
+       1509954037718722697u,   142039123822846312u },
+    {  2152236053329638369u, 11202280800589637091u,
+      16388426812920420176u,    72410041352485523u },
+    { 17319024055671609028u, 10944982848661280484u,
+       2457150158022562661u,    73827744744583080u },
+    { 17511219308535248024u,  5122059497846768077u,
+       2089605804219668451u,    75273205100637900u },
+    { 10082673333144031533u, 14429008783411894887u,
+      12842832230171903890u,    76746965869337783u },
+    { 16196653406315961184u, 10260180891682904501u,
+      10537411930446752461u,    78249581139456266u },
+    { 15084422041749743389u,   234835370106753111u,
+      16662517110286225617u,    79781615848172976u },
+    {  8199644021067702606u,  3787318116274991885u,
+       7438130039325743106u,    81343645993472659u },
+    { 12039493937039359765u,  9773822153580393709u,
+       5945428874398357806u,    82936258850702722u },
+    {   984543865091303961u,  7975107621689454830u,
+       6556665988501773347u,    84560053193370726u },
+    {  9633317878125234244u, 16099592426808915028u,
+       9706674539190598200u,    86215639518264828u },
+    {  6860695058870476186u,  4471839111886709592u,
+       7828342285492709568u,    87903640274981819u },
+    { 14583324717644598331u,  4496120889473451238u,
+       5290040788305728466u,    89624690099949049u },
+    { 18093669366515003715u, 12879506572606942994u,
+      18005739787089675377u,    91379436055028227u },
+    { 17997493966862379937u, 14646222655265145582u,
+      10265023312844161858u,    93168537870790806u },
+    { 12283848109039722318u, 11290258077250314935u,
+       9878160025624946825u,    94992668194556404u },
+    {  8087752761883078164u,  5262596608437575693u,
+      11093553063763274413u,    96852512843287537u },
+    { 15027787746776840781u, 12250273651168257752u,
+       9290470558712181914u,    98748771061435726u },
+    { 15003915578366724489u,  2937334162439764327u,
+       5404085603526796602u,   100682155783835929u },
+    {  5225610465224746757u, 14932114897406142027u,
+       2774647558180708010u,   102653393903748137u },
+    { 17112957703385190360u, 12069082008339002412u,
+       3901112447086388439u,   104663226546146909u },
+    {  4062324464323300238u,  3992768146772240329u,
+      15757196565593695724u,   106712409346361594u },
+    {  5525364615810306701u, 11855206026704935156u,
+      11344868740897365300u,   108801712734172003u },
+    {  9274143661888462646u,  4478365862348432381u,
+      18010077872551661771u,   110931922223466333u },
+    { 12604141221930060148u,  8930937759942591500u,
+       9382183116147201338u,   113103838707570263u },
+    { 14513929377491886653u,  1410646149696279084u,
+        587092196850797612u,   115318278760358235u },
+    {  2226851524999454362u,  7717102471110805679u,
+       7187441550995571734u,   117576074943260147u },
+    {  5527526061344932763u,  2347100676188369132u,
+      16976241418824030445u,   119878076118278875u },
+    {  6088479778147221611u, 17669593130014777580u,
+      10991124207197663546u,   122225147767136307u },
+    { 11107734086759692041u,  3391795220306863431u,
+      17233960908859089158u,   124618172316667879u },
+    {  7913172514655155198u, 17726879005381242552u,
+        641069866244011540u,   127058049470587962u },
+    { 12596991768458713949u, 15714785522479904446u,
+       6035972567136116512u,   129545696547750811u },
+    { 16901996933781815980u,  4275085211437148707u,
+      14091642539965169063u,   132082048827034281u },
+    {  7524574627987869240u, 15661204384239316051u,
+       2444526454225712267u,   134668059898975949u },
+    {  8199251625090479942u,  6803282222165044067u,
+      16064817666437851504u,   137304702024293857u },
+    {  4453256673338111920u, 15269922543084434181u,
+       3139961729834750852u,   139992966499426682u },
+    { 15841763546372731299u,  3013174075437671812u,
+       4383755396295695606u,   142733864029230733u },
+    {  9771896230907310329u,  4900659362437687569u,
+      12386126719044266361u,    72764212553486967u },
+    {  9420455527449565190u,  1859606122611023693u,
+       6555040298902684281u,    74188850200884818u },
+    {  5146105983135678095u,  2287300449992174951u,
+       4325371679080264751u,    75641380576797959u },
+    { 11019359372592553360u,  8422686425957443718u,
+       7175176077944048210u,    77122349788024458u },
+    { 11005742969399620716u,  4132174559240043701u,
+       9372258443096612118u,    78632314633490790u },
+    {  8887589641394725840u,  8029899502466543662u,
+      14582206497241572853u,    80171842813591127u },
+    {   360247523705545899u, 12568341805293354211u,
+      14653258284762517866u,    81741513143625247u },
+    { 12314272731984275834u,  4740745023227177044u,
+       6141631472368337539u,    83341915771415304u },
+    {   441052047733984759u,  7940090120939869826u,
+      11750200619921094248u,    84973652399183278u },
+    {  3436657868127012749u,  9187006432149937667u,
+      16389726097323041290u,    86637336509772529u },
+    { 13490220260784534044u, 15339072891382896702u,
+       8846102360835316895u,    88333593597298497u },
+    {  4125672032094859833u,   158347675704003277u,
+      10592598512749774447u,    90063061402315272u },
+    { 12189928252974395775u,  2386931199439295891u,
+       7009030566469913276u,    91826390151586454u },
+    {  9256479608339282969u,  2844900158963599229u,
+      11148388908923225596u,    93624242802550437u },
+    { 11584393507658707408u,  2863659090805147914u,
+       9873421561981063551u,    95457295292572042u },
+    { 13984297296943171390u,  1931468383973130608u,
+      12905719743235082319u,    97326236793074198u },
+    {  5837045222254987499u, 10213498696735864176u,
+      14893951506257020749u,    99231769968645227u }
+};
+
+static const uint32_t GENERIC_POW5_OFFSETS[311] = {
+    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+    0x00000000, 0x95555964, 0x25565555, 0x65a65695, 0x45449655, 0x44155514,
+    0x04144541, 0x51050155, 0xa6965964, 0x65a69969, 0x69959656, 0x50549559,
+    0x15554145, 0x51051545, 0x51591555, 0x40555110, 0x55550115, 0x55005144,
+    0x14145515, 0x00411400, 0x45511051, 0x10054405, 0x50411004, 0x00144054,
+    0x10500000, 0x04144400, 0x40010040, 0x00440004, 0x00004001, 0x55511550,
+    0x54544114, 0x45545554, 0x44005441, 0x51500455, 0x00054501, 0x00011114,
+    0x55554554, 0x65509555, 0x45559559, 0x15041596, 0x41454545, 0x41050551,
+    0x10405454, 0x14115414, 0x44545555, 0x04155550, 0x15405550, 0x00141541,
+    0x40411445, 0x15400550, 0x00000000, 0x00000005, 0x00000000, 0x56440000,
+    0x91596555, 0x11555555, 0x54569565, 0x04104400, 0x10010005, 0x51451000,
+    0x05500150, 0x05550414, 0x55140450, 0x41414504, 0x44000140, 0x00000001,
+    0x01105410, 0x51140040, 0x04005504, 0x44441004, 0x10001015, 0x04140144,
+    0x55555015, 0x51450551, 0x44445540, 0x01410414, 0x51541414, 0x00001004,
+    0x04155550, 0x41050411, 0x50451145, 0x05005011, 0x00004114, 0x10010500,
+    0x00141045, 0x55515044, 0x10151454, 0x51105454, 0x00004040, 0x01000014,
+    0x11040000, 0x50400101, 0x50541100, 0x01400001, 0x00104110, 0x44001404,
+    0x05545004, 0x50110144, 0x44155440, 0x00000000, 0x10000000, 0x00000000,
+    0x44440001, 0x11004014, 0x10055111, 0x00404010, 0x51405454, 0x51551555,
+    0x15514411, 0x04444400, 0x54014101, 0x00545050, 0x41115511, 0x04510154,
+    0x01140551, 0x15414114, 0x14445110, 0x41551045, 0x50145515, 0x41411454,
+    0x55155050, 0x54514450, 0x54110054, 0x44005155, 0x04501151, 0x51111451,
+    0x55500501, 0x565a6554, 0x55525955, 0x55655555, 0x00405695, 0x05505115,
+    0x51054544, 0x44155040, 0x65555554, 0x65555959, 0x15555655, 0x01009159,
+    0x10001001, 0x55400015, 0x14000544, 0x54500514, 0x55555551, 0x14050105,
+    0x55644155, 0x55555155, 0x95496555, 0x55550555, 0x04415000, 0x54510450,
+    0x44040144, 0x54505101, 0x55556455, 0x55541555, 0x95415555, 0x50515554,
+    0x55555545, 0x55555545, 0x10005455, 0x00000000, 0x00040000, 0x40000050,
+    0x55555954, 0x55655555, 0x55555505, 0x55545595, 0x95552555, 0x96455454,
+    0x55955564, 0x40004000, 0x00000001, 0x00400000, 0x00000000, 0x40041001,
+    0x40000411, 0x55400404, 0x55545644, 0x45655559, 0x49651556, 0x11406595,
+    0x10010000, 0x01000004, 0x00004001, 0x55555154, 0x55155255, 0x59555455,
+    0x45505556, 0x51510555, 0x10554515, 0x50514545, 0x50415554, 0x05015000,
+    0x05441005, 0x50441540, 0x50550455, 0x14554454, 0x55144545, 0x00101440,
+    0x00000004, 0x00004011, 0x50000010, 0x10501450, 0x54011540, 0x04150045,
+    0x00151150, 0x10005101, 0x00001144, 0x01000404, 0x00000000, 0x00000000,
+    0x00000100, 0x05500044, 0x41451151, 0x01511450, 0x00005450, 0x00004004,
+    0x44010004, 0x00001000, 0x00050040, 0x01000541, 0x05410010, 0x05044000,
+    0x45500105, 0x40114104, 0x00144411, 0x00004040, 0x04500000, 0x01015044,
+    0x44400400, 0x00000050, 0x14000100, 0x00000000, 0x14000000, 0x04044404,
+    0x10000140, 0x55541004, 0x44505555, 0x45554555, 0x55455455, 0x54541050,
+    0x55454015, 0x01154541, 0x00045100, 0x44041100, 0x00101501, 0x44000011,
+    0x56966a94, 0x65969559, 0x55665965, 0x00406559, 0x00100155, 0x55541444,
+    0x01011041, 0xa5494954, 0x65955555, 0x55965555, 0x59549555, 0x55699659,
+    0x55555456, 0x969565a6, 0x00000000, 0x00000010, 0x40000140, 0x00000000,
+    0x00000000, 0x00000401, 0x00000000, 0x14154544, 0x11454114, 0x54104154,
+    0x04000154, 0x04000401, 0x00000411, 0x05040450, 0x00000010, 0x00000010,
+    0x00001040, 0x55540000, 0x51556595, 0x55491555, 0x55515555, 0x14555410,
+    0x54554541, 0x05105554, 0x55540455, 0x95555555, 0x55556465, 0x64554565,
+    0x55654514, 0x45245655, 0x55559545, 0x55546552, 0x41155556, 0x95554554,
+    0x51515555, 0x00000000, 0x40000550, 0x00100050, 0x40000000, 0x50440440,
+    0x40010500, 0x10450404, 0x00040000, 0x00004000, 0x00000000
+};
+
+static const uint64_t GENERIC_POW5_INV_SPLIT[89][4] = {
+    {                    1u,                    0u,
+                         0u,   144115188075855872u },
+    {  1573859546583440066u,  2691002611772552616u,
+       6763753280790178510u,   141347765182270746u },
+    { 12960290449513840413u, 12345512957918226762u,
+      18057899791198622765u,   138633484706040742u },
+    {  7615871757716765417u,  9507132263365501332u,
+       4879801712092008245u,   135971326161092377u },
+    {  7869961150745287588u,  5804035291554591636u,
+       8883897266325833928u,   133360288657597085u },
+    {  2942118023529634768u, 15128191429820565086u,
+      10638459445243230718u,   130799390525667397u },
+    { 14188759758411913795u,  5362791266439207815u,
+       8068821289119264054u,   128287668946279217u },
+    {  7183196927902545213u,  1952291723540117099u,
+      12075928209936341512u,   125824179589281448u },
+    {  5672588001402349749u, 17892323620748423487u,
+       9874578446960390364u,   123407996258356868u },
+    {  4442590541217566326u,  4558254706293456445u,
+      10343828952663182727u,   121038210542800766u },
+    {  3005560928406962567u,  2082271027139057888u,
+      13961184524927245081u,   118713931475986426u },
+    { 13299058168408384787u, 17834349496131278595u,
+       9029906103900731664u,   116434285200389047u },
+    {  5414878118283973036u, 13079825470227392078u,
+      17897304791683760280u,   114198414639042157u },
+    { 14609755883382484835u, 14991702445765844156u,
+       3269802549772755411u,   112005479173303009u },
+    { 15967774957605076028u,  2511532636717499923u,
+      16221038267832563171u,   109854654326805788u },
+    {  9269330061621627146u,  3332501053426257392u,
+      16223281189403734630u,   107745131455483836u },
+    { 16739559299223642283u,  1873986623300664530u,
+       6546709159471442872u,   105676117443544318u },
+    { 17116435360051202056u,  1359075105581853924u,
+       2038341371621886470u,   103646834405281051u },
+    { 17144715798009627551u,  3201623802661132408u,
+       9757551605154622431u,   101656519392613377u },
+    { 17580479792687825858u,  6546633380567327312u,
+      15099972427870912398u,    99704424108241124u },
+    {  9726477118325522903u, 14578369026754005435u,
+      11728055595254428803u,    97789814624307808u },
+    {   134593949518343636u,  5715151379816901985u,
+       1660163707976377376u,    95911971106466306u },
+    {  5515914027713859359u,  7124354893273815720u,
+       5548463282858794077u,    94070187543243255u },
+    {  6188403395862945513u,  5681264392632320838u,
+      15417410852121406654u,    92263771480600430u },
+    { 15908890877468271458u, 10398888261125597540u,
+       4817794962769172309u,    90492043761593298u },
+    {  1413077535082201006u, 12675058125384151580u,
+       7731426132303759597u,    88754338271028867u },
+    {  1486733163972670294u, 11369385300195092554u,
+      11610016711694864110u,    87050001685026843u },
+    {  8788596583757589685u,  3978580923851924802u,
+       9255162428306775812u,    85378393225389919u },
+    {  7203518319660962121u, 15044736224407683725u,
+       2488132019818199792u,    83738884418690858u },
+    {  4004175967662388708u, 18236988667757575407u,
+      15613100370957482671u,    82130858859985791u },
+    { 18371903370586036464u,    53497579022921640u,
+      16465963977267203307u,    80553711981064899u },
+    { 10170778323887491316u,  1999668801648976001u,
+      10209763593579456445u,    79006850823153334u },
+    { 17108131712433974547u, 16825784443029944237u,
+       2078700786753338945u,    77489693813976938u },
+    { 17221789422665858533u, 12145427517550446164u,
+       5391414622238668005u,    76001670549108934u },
+    {  4859588996898795879u,  1715798948121313204u,
+       3950858167455137171u,    74542221577515387u },
+    { 13513469241795711527u,   631367850494860526u,
+      10517278915021816160u,    73110798191218799u },
+    { 11757513142672073112u,  2581974932255022228u,
+      17498959383193606459u,   143413724438001539u },
+    { 14524355192525042818u,  5640643347559376447u,
+       1309659274756813016u,   140659771648132296u },
+    {  2765095348461978539u, 11021111021896007722u,
+       3224303603779962366u,   137958702611185230u },
+    { 12373410389187981038u, 13679193545685856195u,
+      11644609038462631561u,   135309501808182158u },
+    { 12813176257562780152u,  3754199046160268020u,
+       9954691079802960722u,   132711173221007413u },
+    { 17557452279667723459u,  3237799193992485824u,
+      17893947919029030695u,   130162739957935629u },
+    { 14634200999559435156u,  4123869946105211004u,
+       6955301747350769239u,   127663243886350468u },
+    {  2185352760627740241u,  2864813346878886844u,
+      13049218671329690184u,   125211745272516185u },
+    {  6143438674322183003u, 10464733336980678750u,
+       6982925169933978309u,   122807322428266620u },
+    {  1099509117817174577u, 10202656147550524081u,
+        754997032816608484u,   120449071364478757u },
+    {  2410631293559367024u, 17407273750261453804u,
+      15307291918933463037u,   118136105451200587u },
+    { 12224968375134586698u,  1664436604907828062u,
+      11506086230137787358u,   115867555084305488u },
+    {  3495926216898000889u, 18392536965197424288u,
+      10992889188570643156u,   113642567358547782u },
+    {  8744506286256259681u,  3966568369496879937u,
+      18342264969761820037u,   111460305746896569u },
+    {  7689600520560455040u,  5254331190877624630u,
+       9628558080573245556u,   109319949786027263u },
+    { 11862637625618819437u,  3456120362318976488u,
+      14690471063106001082u,   107220694767852583u },
+    {  5697330450030126445u, 12424082405392918899u,
+        358204170751754904u,   105161751436977040u },
+    { 11257457505097373623u, 15373192700214208870u,
+        671619062372033814u,   103142345693961148u },
+    { 16850355018477166701u,  1913910419361963966u,
+       4550257919755970531u,   101161718304283822u },
+    {  9670835567561997012u, 10584031339132130638u,
+       3060560222974851757u,    99219124612893520u },
+    {  7698686577353054711u, 11689292838639130817u,
+      11806331021588878241u,    97313834264240819u },
+    { 12233569599615692138u,  3347791226108469959u,
+      10333904326094451110u,    95445130927687169u },
+    { 13049400362825383934u, 17142621313007799680u,
+       3790542585289224168u,    93612312028186576u },
+    { 12430457242474442073u,  5625077542189557960u,
+      14765055286236672238u,    91814688482138969u },
+    {  4759444137752473129u,  2230562561567025078u,
+       4954443037339580076u,    90051584438315940u },
+    {  7246913525170274759u,  8910297835195760709u,
+       4015904029508858381u,    88322337023761438u },
+    { 12854430245836432068u,  8135139748065431455u,
+      11548083631386317976u,    86626296094571907u },
+    {  4848827254502687804u,  4789491250196085625u,
+       3988192420450664125u,    84962823991462151u },
+    {  7435538409611286685u,   904061756819742353u,
+      14598026519493048444u,    83331295300025028u },
+    { 11042616160352530998u,  8948390828345326218u,
+      10052651191118271927u,    81731096615594853u },
+    { 11059348291563778944u, 11696515766184685544u,
+       3783210511290897367u,    80161626312626082u },
+    {  7020010856491885827u,  5025093219346041680u,
+       8960210401638911765u,    78622294318500592u },
+    { 17732844474490699985u,  7820866704994446502u,
+       6088373186798844243u,    77112521891678506u },
+    {   688278527545590502u,  3045610706602776618u,
+       8684243536999567610u,    75631741404109150u },
+    {  2734573255120657298u,  3903146411440697663u,
+       9470794821691856713u,    74179396127820347u },
+    { 15996457521023071260u,  4776627823451271680u,
+      12394856457265744744u,    72754940025605801u },
+    { 13492065758834518332u,  7390517611012222399u,
+       1630485387832860230u,   142715675091463768u },
+    { 13665021627282055865u,  9897834675523659302u,
+      17907668136755296849u,   139975126841173266u },
+    {  9603773719399446182u, 10771916301484339398u,
+      10672699855989487527u,   137287204938390542u },
+    {  3630218541553511266u,  8139010004241080614u,
+       2876479648932814543u,   134650898807055963u },
+    {  8318835909686377085u,  9525369258927993371u,
+       2796120270400437057u,   132065217277054270u },
+    { 11190003059043290164u, 12424345635599592110u,
+      12539346395388933763u,   129529188211565064u },
+    {  8701968833973242277u,   820569587086330727u,
+       2315591597351480110u,   127041858141569228u },
+    {  5115113890115690488u, 16906305245394587826u,
+       9899749468931071388u,   124602291907373862u },
+    { 15543535488939245975u, 10945189844466391399u,
+       3553863472349432246u,   122209572307020975u },
+    {  7709257252608325039u,  1191832167690640880u,
+      15077137020234258537u,   119862799751447719u },
+    {  7541333244210021738u,  9790054727902174575u,
+       5160944773155322014u,   117561091926268545u },
+    { 12297384708782857833u,  1281328873123467374u,
+       4827925254630475769u,   115303583460052092u },
+    { 13243237906232367266u, 15873887428139547641u,
+       3607993172301799599u,   113089425598968120u },
+    { 11384616453739611115u, 15184114243769211033u,
+      13148448124803481057u,   110917785887682141u },
+    { 17727970963596660684u,  1196965221832671990u,
+      14537830463956404138u,   108787847856377790u },
+    { 17241367586707330932u,  8880584684128262874u,
+      11173506540726547818u,   106698810713789254u },
+    {  7184427196661305644u, 14332510582433188173u,
+      14230167953789677901u,   104649889046128358u }
+};
+
+static const uint32_t GENERIC_POW5_INV_OFFSETS[307] = {
+    0x14145504, 0x11441555, 0x55401141, 0x00005415, 0x00000000, 0x00000000,
+    0x00000000, 0x01544540, 0x15544440, 0x41141055, 0x11500415, 0x00010011,
+    0x10011000, 0x40414114, 0x15155014, 0x55501145, 0x41554551, 0x14041000,
+    0x50404410, 0x05150004, 0x01140004, 0x50545444, 0x05555105, 0x51555010,
+    0x00105515, 0x11441410, 0x00500000, 0x05415000, 0x40444140, 0x11041055,
+    0x55514110, 0x40000150, 0x50004005, 0x00540104, 0x04100005, 0x41555154,
+    0x45155555, 0x51551450, 0x15440558, 0x15115555, 0x55515555, 0x55585445,
+    0x00000010, 0x00000000, 0x00000050, 0x50040000, 0x00000010, 0x14155101,
+    0x44514500, 0x45455554, 0x55555551, 0x51551515, 0x44044554, 0x14415401,
+    0x45544400, 0x51501040, 0x01444040, 0x54505454, 0x45501400, 0x55544550,
+    0x55555145, 0x46551555, 0x55455055, 0x10000100, 0x00055004, 0x10000040,
+    0x04000005, 0x44554051, 0x04150545, 0x45001145, 0x14000000, 0x00000000,
+    0x00000000, 0x54500000, 0x11445555, 0x55145515, 0x40555451, 0x41115010,
+    0x00054444, 0x45154455, 0x04100441, 0x51015001, 0x55545055, 0x15451151,
+    0x00000000, 0x00000000, 0x00100000, 0x15540000, 0x95551555, 0x55555455,
+    0x51455955, 0x55550518, 0x55555559, 0x55555555, 0x11001555, 0x00004000,
+    0x00040000, 0x00000044, 0x55554554, 0x54555115, 0x44115445, 0x56145555,
+    0x45555155, 0x64551561, 0x55415455, 0x54558554, 0x44555545, 0x55155551,
+    0x00145155, 0x01144000, 0x00450511, 0x00000510, 0x54445100, 0x44551545,
+    0x41544455, 0x45541501, 0x559a5965, 0x65955555, 0x54559559, 0x55555558,
+    0x59616595, 0x95696545, 0x40005565, 0x10400440, 0x00011044, 0x10100105,
+    0x45154540, 0x15540155, 0x01545441, 0x44405554, 0x50550105, 0x10144414,
+    0x10504145, 0x45454004, 0x41040151, 0x50151115, 0x54000410, 0x51450511,
+    0x44545044, 0x10400010, 0x00151410, 0x40014000, 0x44040000, 0x05400000,
+    0x54411544, 0x05105554, 0x54141550, 0x04000540, 0x45001100, 0x10010411,
+    0x40000000, 0x00000001, 0x14100000, 0x00000000, 0x54000140, 0x15440054,
+    0x05445145, 0x40500555, 0x04504155, 0x00115111, 0x15045055, 0x55055444,
+    0x45515554, 0x11551544, 0x00004555, 0x00000000, 0x00000000, 0x00000000,
+    0x10400004, 0x51010105, 0x44440400, 0x15140450, 0x55515555, 0x55155195,
+    0x41555545, 0x45545454, 0x55551515, 0x15510559, 0x11505515, 0x01500000,
+    0x40400000, 0x00440050, 0x04010050, 0x00040010, 0x04450414, 0x00000510,
+    0x01001144, 0x01140011, 0x01000001, 0x04010000, 0x01000401, 0x45000100,
+    0x00005000, 0x00041000, 0x41101100, 0x01050004, 0x50454540, 0x04554555,
+    0x44105505, 0x54040501, 0x40555455, 0x41015105, 0x11451555, 0x10555414,
+    0x10115505, 0x54514451, 0x10101545, 0x11541100, 0x50054055, 0x11451404,
+    0x15551554, 0x55555654, 0x55555555, 0x15505595, 0x45045141, 0x55555415,
+    0x50500100, 0x45554554, 0x45554555, 0x55104545, 0x15045455, 0x15101401,
+    0x40111510, 0x10010500, 0x55555504, 0x55554545, 0x45515554, 0x99541555,
+    0x55555555, 0x65966565, 0x51555559, 0x01404100, 0x10001544, 0x00111040,
+    0x9a680501, 0x96566965, 0x55556955, 0x5655a559, 0x14404514, 0x40151110,
+    0x54505145, 0x14141555, 0x11051404, 0x05400400, 0x00015005, 0x10100000,
+    0x50004410, 0x00100540, 0x14000100, 0x50411040, 0x00100001, 0x44400105,
+    0x04545554, 0x11555105, 0x45115541, 0x04501515, 0x00110440, 0x40001004,
+    0x10514440, 0x10044400, 0x50450000, 0x00001150, 0x55541500, 0x05454044,
+    0x55505101, 0x10510515, 0x54544144, 0x55051445, 0x55515550, 0x45505455,
+    0x50045445, 0x00154004, 0x00554415, 0x45141554, 0x51050151, 0x45550550,
+    0x50001014, 0x15114414, 0x10404414, 0x45445545, 0x45545450, 0x41151155,
+    0x55551555, 0x55005415, 0x44155015, 0x55500105, 0x45545500, 0x01444140,
+    0x01050150, 0x41540500, 0x11000145, 0x55505111, 0x55000151, 0x11145040,
+    0x01451040, 0x51040411, 0x01051441, 0x00105014, 0x50504401, 0x00105014,
+    0x40044444, 0x45545854, 0x51450455, 0x51555559, 0x00105555, 0x00400004,
+    0x00000001
+};
+
+// Returns floor(log_2(5^e)) + 1; requires 0 <= e <= 5999.
+static inline uint32_t pow5bits_128(const uint32_t e) {
+    return (uint32_t) (((e * 163391164108059ull) >> 46) + 1);
+}
+
+// Returns floor(log_10(2^e)); requires 0 <= e <= 16999.
+static inline uint32_t log10Pow2_128(const uint32_t e) {
+    return (uint32_t) ((e * 169464822037455ull) >> 49);
+}
+
+// Returns floor(log_10(5^e)); requires 0 <= e <= 16999.
+static inline uint32_t log10Pow5_128(const uint32_t e) {
+    return (uint32_t) ((e * 196742565691928ull) >> 48);
+}
+
+// Sets p to the 6-word product of the 4 words of a and the 2 words of b.
+static inline void mul_256_128(const uint64_t* const a, 
+    const uint64_t* const b, uint64_t* const p)
+{
+    memset(p, 0, 6 * sizeof(uint64_t));
+    for (int i = 0; i < 2; i++) {
+        uint64_t carry = 0;
+        for (int k = 0; k < 4; k++) {
+            const uint128_t t = (uint128_t) b[i] * a[k] + p[i + k] + carry;
+            p[i + k] = (uint64_t) t;
+            carry = (uint64_t) (t >> 64);
+        }
+        p[i + 4] = carry;
+    }
+}
+
+// Returns word k of the 6 words of p, shifted right by shift bits.
+static inline uint64_t shifted_word(const uint64_t* const p, 
+    const uint32_t shift, const uint32_t k)
+{
+    const uint32_t w = shift / 64 + k;
+    const uint32_t b = shift % 64;
+    const uint64_t lo = w < 6 ? p[w] : 0;
+    const uint64_t hi = w + 1 < 6 ? p[w + 1] : 0;
+    return b == 0 ? lo : (lo >> b) | (hi << (64 - b));
+}
+
+// Sets result to the 4 low words of p shifted right by shift, plus add.
+static inline void shift_add(const uint64_t* const p, const uint32_t shift,
+    uint64_t add, uint64_t* const result)
+{
+    for (uint32_t k = 0; k < 4; k++) {
+        const uint64_t w = shifted_word(p, shift, k);
+        result[k] = w + add;
+        add = result[k] < w;
+    }
+}
+
+// Computes 5^i in the form required by Ryu, like double_computePow5.
+static inline void generic_computePow5(const uint32_t i, 
+    uint64_t* const result)
+{
+    const uint32_t base = i / GENERIC_POW5_TABLE_SIZE;
+    const uint32_t base2 = base * GENERIC_POW5_TABLE_SIZE;
+    const uint32_t offset = i - base2;
+    assert(base < sizeof(GENERIC_POW5_SPLIT) / sizeof(GENERIC_POW5_SPLIT[0]));
+    const uint64_t* const mul = GENERIC_POW5_SPLIT[base];
+    if (offset == 0) {
+        memcpy(result, mul, 4 * sizeof(uint64_t));
+        return;
+    }
+    uint64_t p[6];
+    mul_256_128(mul, GENERIC_POW5_TABLE[offset], p);
+    const uint32_t delta = pow5bits_128(i) - pow5bits_128(base2);
+    shift_add(p, delta, (GENERIC_POW5_OFFSETS[i / 16] >> ((i % 16) << 1)) & 3,
+        result);
+}
+
+// Computes 5^-i in the form required by Ryu, like double_computeInvPow5.
+static inline void generic_computeInvPow5(const uint32_t i, 
+    uint64_t* const result)
+{
+    const uint32_t base = (i + GENERIC_POW5_TABLE_SIZE - 1) / 
+        GENERIC_POW5_TABLE_SIZE;
+    const uint32_t base2 = base * GENERIC_POW5_TABLE_SIZE;
+    const uint32_t offset = base2 - i;
+    assert(base < sizeof(GENERIC_POW5_INV_SPLIT) / 
+        sizeof(GENERIC_POW5_INV_SPLIT[0]));
+    const uint64_t* const mul = GENERIC_POW5_INV_SPLIT[base]; // 1/5^base2
+    if (offset == 0) {
+        memcpy(result, mul, 4 * sizeof(uint64_t));
+        return;
+    }
+    // The entries are rounded up, so one less is rounded down.
+    uint64_t lower[4];
+    uint64_t borrow = 1;
+    for (int k = 0; k < 4; k++) {
+        lower[k] = mul[k] - borrow;
+        borrow = mul[k] < borrow;
+    }
+    uint64_t p[6];
+    mul_256_128(lower, GENERIC_POW5_TABLE[offset], p); // 5^offset
+    const uint32_t delta = pow5bits_128(base2) - pow5bits_128(i);
+    shift_add(p, delta, 1 + 
+        ((GENERIC_POW5_INV_OFFSETS[i / 16] >> ((i % 16) << 1)) & 3), result);
+}
+
+// Returns (m * mul) >> j, which has to fit into 128 bits.
+static inline uint128_t mulShift_128(const uint128_t m, 
+    const uint64_t* const mul, const int32_t j)
+{
+    const uint64_t b[2] = { (uint64_t) m, (uint64_t) (m >> 64) };
+    uint64_t p[6];
+    mul_256_128(mul, b, p);
+    assert(shifted_word(p, (uint32_t) j, 2) == 0);
+    return ((uint128_t) shifted_word(p, (uint32_t) j, 1) << 64) | 
+        shifted_word(p, (uint32_t) j, 0);
+}
+
+static inline uint32_t pow5Factor_128(uint128_t value) {
+    uint32_t count = 0;
+    for (;;) {
+        assert(value != 0);
+        if (value % 5 != 0) {
+            return count;
+        }
+        value /= 5;
+        ++count;
+    }
+}
+
+// Returns true if value is divisible by 5^p.
+static inline bool multipleOfPowerOf5_128(const uint128_t value, 
+    const uint32_t p)
+{
+    return pow5Factor_128(value) >= p;
+}
+
+// Returns true if value is divisible by 2^p.
+static inline bool multipleOfPowerOf2_128(const uint128_t value, 
+    const uint32_t p)
+{
+    assert(p < 128);
+    return (value & (((uint128_t) 1 << p) - 1)) == 0;
+}
+
+typedef struct floating_decimal_128 {
+    uint128_t mantissa;
+    int32_t exponent;
+} floating_decimal_128;
+
+// Converts a binary float with mantissaBits mantissa bits and a 15-bit
+// exponent, like d2d. If explicitLeadingBit is set, the leading bit of the
+// mantissa is stored, as in the x87 format.
+static inline floating_decimal_128 g2d(const uint128_t ieeeMantissa, 
+    const uint32_t ieeeExponent, const int32_t mantissaBits, 
+    const bool explicitLeadingBit)
+{
+    int32_t e2;
+    uint128_t m2;
+    if (explicitLeadingBit) {
+        // We subtract 2 so that the bounds computation has 2 additional bits.
+        e2 = (ieeeExponent == 0 ? 1 : (int32_t) ieeeExponent) - 
+            GENERIC_BIAS - mantissaBits + 1 - 2;
+        m2 = ieeeMantissa;
+    } else if (ieeeExponent == 0) {
+        e2 = 1 - GENERIC_BIAS - mantissaBits - 2;
+        m2 = ieeeMantissa;
+    } else {
+        e2 = (int32_t) ieeeExponent - GENERIC_BIAS - mantissaBits - 2;
+        m2 = ((uint128_t) 1 << mantissaBits) | ieeeMantissa;
+    }
+    const bool even = (m2 & 1) == 0;
+    const bool acceptBounds = even;
+
+    // Step 2: Determine the interval of valid decimal representations.
+    const uint128_t mv = 4 * m2;
+    // Implicit bool -> int conversion. True is 1, false is 0.
+    const uint32_t mmShift = ieeeMantissa != (explicitLeadingBit ? 
+        (uint128_t) 1 << (mantissaBits - 1) : 0) || ieeeExponent <= 1;
+
+    // Step 3: Convert to a decimal power base using 256-bit arithmetic.
+    uint128_t vr, vp, vm;
+    int32_t e10;
+    bool vmIsTrailingZeros = false;
+    bool vrIsTrailingZeros = false;
+    uint64_t pow5[4];
+    if (e2 >= 0) {
+        const uint32_t q = log10Pow2_128((uint32_t) e2) - (e2 > 3);
+        e10 = (int32_t) q;
+        const int32_t k = GENERIC_POW5_INV_BITCOUNT + 
+            (int32_t) pow5bits_128(q) - 1;
+        const int32_t i = -e2 + (int32_t) q + k;
+        generic_computeInvPow5(q, pow5);
+        vr = mulShift_128(4 * m2, pow5, i);
+        vp = mulShift_128(4 * m2 + 2, pow5, i);
+        vm = mulShift_128(4 * m2 - 1 - mmShift, pow5, i);
+        // floor(log_5(2^128)) = 55, this is very conservative.
+        if (q <= 55) {
+            // Only one of mp, mv, and mm can be a multiple of 5, if any.
+            if (mv % 5 == 0) {
+                vrIsTrailingZeros = multipleOfPowerOf5_128(mv, q - 1);
+            } else if (acceptBounds) {
+                vmIsTrailingZeros = multipleOfPowerOf5_128(mv - 1 - mmShift,
+                    q);
+            } else {
+                vp -= multipleOfPowerOf5_128(mv + 2, q);
+            }
+        }
+    } else {
+        const uint32_t q = log10Pow5_128((uint32_t) -e2) - (-e2 > 1);
+        e10 = (int32_t) q + e2;
+        const int32_t i = -e2 - (int32_t) q;
+        const int32_t k = (int32_t) pow5bits_128((uint32_t) i) - 
+            GENERIC_POW5_BITCOUNT;
+        const int32_t j = (int32_t) q - k;
+        generic_computePow5((uint32_t) i, pow5);
+        vr = mulShift_128(4 * m2, pow5, j);
+        vp = mulShift_128(4 * m2 + 2, pow5, j);
+        vm = mulShift_128(4 * m2 - 1 - mmShift, pow5, j);
+        if (q <= 1) {
+            // {vr,vp,vm} is trailing zeros if {mv,mp,mm} has at least q
+            // trailing 0 bits. mv = 4 * m2, so it always has at least two
+            // trailing 0 bits.
+            vrIsTrailingZeros = true;
+            if (acceptBounds) {
+                // mm = mv - 1 - mmShift, so it has 1 trailing 0 bit iff
+                // mmShift == 1.
+                vmIsTrailingZeros = mmShift == 1;
+            } else {
+                // mp = mv + 2, so it always has at least one trailing 0 bit.
+                --vp;
+            }
+        } else if (q < 127) {
+            // We need to compute min(ntz(mv), pow5Factor(mv) - e2) >= q - 1.
+            vrIsTrailingZeros = multipleOfPowerOf2_128(mv, q - 1);
+        }
+    }
+
+    // Step 4: Find the shortest decimal representation in the interval of
+    // valid representations.
+    int32_t removed = 0;
+    uint8_t lastRemovedDigit = 0;
+    while (vp / 10 > vm / 10) {
+        vmIsTrailingZeros &= vm % 10 == 0;
+        vrIsTrailingZeros &= lastRemovedDigit == 0;
+        lastRemovedDigit = (uint8_t) (vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+    }
+    if (vmIsTrailingZeros) {
+        while (vm % 10 == 0) {
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = (uint8_t) (vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+    }
+    if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+        // Round even if the exact number is .....50..0.
+        lastRemovedDigit = 4;
+    }
+    // We need to take vr + 1 if vr is outside bounds or we need to round up.
+    floating_decimal_128 fd;
+    fd.mantissa = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) ||
+        lastRemovedDigit >= 5);
+    fd.exponent = e10 + removed;
+    return fd;
+}
+
+// Decodes the bits of a binary float with a 15-bit exponent into its sign and
+// shortest decimal representation, like d2s_decode.
+static inline bool g2s_decode(const uint128_t bits, 
+    const int32_t mantissaBits, const bool explicitLeadingBit, 
+    bool* const sign, floating_decimal_128* const v)
+{
+    const uint128_t ieeeMantissa = bits & 
+        (((uint128_t) 1 << mantissaBits) - 1);
+    const uint32_t ieeeExponent = (uint32_t) (bits >> mantissaBits) & 
+        ((1u << GENERIC_EXPONENT_BITS) - 1);
+    *sign = ((bits >> (mantissaBits + GENERIC_EXPONENT_BITS)) & 1) != 0;
+    if (ieeeExponent == ((1u << GENERIC_EXPONENT_BITS) - 1u)) {
+        RYU_STAT(special);
+        // The x87 leading bit is set for both infinity and NaN.
+        v->mantissa = explicitLeadingBit ? 
+            ieeeMantissa & (((uint128_t) 1 << (mantissaBits - 1)) - 1) :
+            ieeeMantissa;
+        v->exponent = 0;
+        return false;
+    }
+    if (ieeeExponent == 0 && ieeeMantissa == 0) {
+        RYU_STAT(zero);
+        v->mantissa = 0;
+        v->exponent = 0;
+        return true;
+    }
+    RYU_STAT(general);
+    *v = g2d(ieeeMantissa, ieeeExponent, mantissaBits, explicitLeadingBit);
+    return true;
+}
+
+// The most digits of a shortest binary128, with one more when rounding up
+// carries into the next power of ten.
+#define GENERIC_MAX_DIGITS 37
+
+// Divides m by 10^9 in 32-bit limbs and returns the remainder. Dividing the
+// 128-bit value directly is a library call, while each limb step compiles to
+// a multiplication.
+static inline uint32_t div1e9_128(uint128_t* const m) {
+    uint128_t q = 0;
+    uint64_t r = 0;
+    for (int32_t i = 3; i >= 0; i--) {
+        const uint64_t cur = r << 32 | (uint32_t) (*m >> (32 * i));
+        q = q << 32 | (cur / 1000000000);
+        r = cur % 1000000000;
+    }
+    *m = q;
+    return (uint32_t) r;
+}
+
+// Writes the decimal digits of m, no more than 10^37, to result. Returns the
+// number of digits.
+static inline uint32_t write_digits_128(uint128_t m, char* const result) {
+    // Blocks of nine digits come off the bottom until the rest fits 64 bits,
+    // which takes at most two.
+    uint32_t blocks[2];
+    uint32_t n = 0;
+    while ((m >> 64) != 0) {
+        blocks[n++] = div1e9_128(&m);
+    }
+    const uint64_t m64 = (uint64_t) m;
+    uint32_t olength = decimalLength20(m64);
+    if (olength <= 17) {
+        write_digits(m64, olength, result);
+    } else {
+        write_digits(m64 / 1000000000, olength - 9, result);
+        write_nine_digits((uint32_t) (m64 % 1000000000), 
+            result + olength - 9);
+    }
+    while (n > 0) {
+        write_nine_digits(blocks[--n], result + olength);
+        olength += 9;
+    }
+    return olength;
+}
+
+// Prints the finite decoded value v like print_format, with the same rules
+// for the fixed and exponent forms. The exponents can have four digits, and
+// the fixed form thousands, so the output is appended in pieces instead of
+// going through a buffer.
+static size_t print_decimal_128(const floating_decimal_128 v, 
+    const bool sign, const struct options *o, char dst[], size_t nbytes)
+{
+    char digits[GENERIC_MAX_DIGITS + 1];
+    const int32_t olength = (int32_t) write_digits_128(v.mantissa, digits);
+    const int32_t exp = v.exponent + olength - 1;
+    const uint32_t aexp = (uint32_t) (exp < 0 ? -exp : exp);
+    // A lone trailing zero after the decimal point is dropped.
+    const bool integral = exp >= 0 && (exp + 1 >= olength || 
+        (exp + 2 == olength && digits[olength - 1] == '0'));
+    const size_t flen = exp < 0 ? (size_t) (sign + 1 - exp + olength) :
+        integral ? (size_t) (sign + exp + 1) : (size_t) (sign + olength + 1);
+    const size_t elen = (size_t) (sign + olength + (olength > 1) + 2 + 
+        (exp < 0 || o->j) + (aexp >= 10) + (aexp >= 100) + (aexp >= 1000));
+    bool fixed = o->f;
+    if (o->g) {
+        // Javascript switches to exponents at 1e21.
+        fixed = o->j ? flen <= (size_t) 21 + sign : flen <= elen;
+    }
+    RYU_STAT_ADD(fixed, o->g && fixed);
+    RYU_STAT_ADD(exponent, o->g && !fixed);
+    size_t pos = 0;
+    if (sign) {
+        append_partial(dst, nbytes, &pos, "-", 1);
+    }
+    if (!fixed) {
+        append_partial(dst, nbytes, &pos, digits, 1);
+        if (olength > 1) {
+            append_partial(dst, nbytes, &pos, ".", 1);
+            append_partial(dst, nbytes, &pos, digits + 1, 
+                (size_t) olength - 1);
+        }
+        char suffix[7];
+        int n = 0;
+        suffix[n++] = o->ech;
+        if (exp < 0) {
+            suffix[n++] = '-';
+        } else if (o->j) {
+            suffix[n++] = '+';
+        }
+        const int elength = 1 + (aexp >= 10) + (aexp >= 100) + (aexp >= 1000);
+        for (uint32_t e = aexp, i = 0; i < (uint32_t) elength; i++, e /= 10) {
+            suffix[n + elength - 1 - (int) i] = (char) ('0' + e % 10);
+        }
+        append_partial(dst, nbytes, &pos, suffix, (size_t) (n + elength));
+    } else if (exp < 0) {
+        // 0.000ddd
+        append_partial(dst, nbytes, &pos, "0.", 2);
+        append_zeros(dst, nbytes, &pos, (size_t) (-exp - 1));
+        append_partial(dst, nbytes, &pos, digits, (size_t) olength);
+    } else if (integral) {
+        // ddd000
+        const size_t ilength = (size_t) exp + 1;
+        const size_t n = ilength < (size_t) olength ? ilength : 
+            (size_t) olength;
+        append_partial(dst, nbytes, &pos, digits, n);
+        append_zeros(dst, nbytes, &pos, ilength - n);
+    } else {
+        // ddd.ddd
+        append_partial(dst, nbytes, &pos, digits, (size_t) exp + 1);
+        append_partial(dst, nbytes, &pos, ".", 1);
+        append_partial(dst, nbytes, &pos, digits + exp + 1, 
+            (size_t) (olength - exp - 1));
+    }
+    return pos;
+}
+
+// Converts the decoded long double or binary128 v like ryu_string.
+static size_t string_128(const floating_decimal_128 v, const bool sign,
+    const bool finite, char fmt, char dst[], size_t nbytes)
+{
+    const struct ryu_options opts = { .format = fmt };
+    struct options o;
+    size_t len = 0;
+    if (fmt != 0 && resolve_options(&opts, &o)) {
+        const size_t n = nbytes > 0 ? nbytes - 1 : 0;
+        if (finite) {
+            len = print_decimal_128(v, sign, &o, dst, n);
+        } else {
+            const int i = v.mantissa != 0 ? 0 : sign ? 2 : 1;
+            len = write_partial(dst, n, o.special[i], o.speciallen[i]);
+        }
+    }
+    if (nbytes > 0) {
+        dst[len < nbytes ? len : nbytes - 1] = '\0';
+    }
+    return len;
+}
+
+#endif // HAS_GENERIC_128
+
+#if defined(HAS_LONG_DOUBLE)
+
+RYU_EXTERN
+size_t ryu_string_ld(long double x, char fmt, char dst[], size_t nbytes) {
+#if LDBL_MANT_DIG == 53
+    return ryu_string((double) x, fmt, dst, nbytes);
+#else
+    uint128_t bits = 0;
+    bool sign;
+    floating_decimal_128 v;
+#if LDBL_MANT_DIG == 64
+    // The 80-bit x87 format, in the low 10 bytes.
+    memcpy(&bits, &x, 10);
+    const bool finite = g2s_decode(bits, 64, true, &sign, &v);
+#else
+    memcpy(&bits, &x, sizeof(bits));
+    const bool finite = g2s_decode(bits, 112, false, &sign, &v);
+#endif
+    return string_128(v, sign, finite, fmt, dst, nbytes);
+#endif
+}
+
+#endif // HAS_LONG_DOUBLE
+
+#if defined(HAS_GENERIC_128) && defined(__SIZEOF_FLOAT128__)
+
+RYU_EXTERN
+size_t ryu_string_f128(__float128 x, char fmt, char dst[], size_t nbytes) {
+    uint128_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bool sign;
+    floating_decimal_128 v;
+    const bool finite = g2s_decode(bits, 112, false, &sign, &v);
+    return string_128(v, sign, finite, fmt, dst, nbytes);
+}
+
+#endif
+
+#ifndef RYU_FREESTANDING
+
+// The number of values in each task of ryu_string_many_parallel.
+#define PARALLEL_CHUNK 4096
+
+struct parallel_chunk {
+    struct ryu_writer w;
+    size_t start;
+    size_t count;
+    size_t offset;
+    bool failed;
+};
+
+struct parallel_job {
+    const double* values;
+    size_t* lens;
+    char fmt;
+    const char* sep;
+    size_t seplen;
+    char* dst;
+    size_t avail;
+    struct parallel_chunk* chunks;
+};
+
+// Grows the buffer of a chunk's writer.
+static bool parallel_grow(struct ryu_writer* w, size_t need) {
+    const size_t cap = w->cap * 2 + need;
+    char* buf = (char*) realloc(w->buf, cap);
+    if (!buf) {
+        return false;
+    }
+    w->buf = buf;
+    w->cap = cap;
+    return true;
+}
+
+// Formats the values of chunk i, and their separators, into its own buffer.
+static void parallel_format(void* arg, size_t i) {
+    struct parallel_job* job = (struct parallel_job*) arg;
+    struct parallel_chunk* c = &job->chunks[i];
+    c->w.flush = parallel_grow;
+    for (size_t k = c->start; k < c->start + c->count; k++) {
+        if (k > 0 && job->seplen > 0 && 
+            ryu_write_bytes(&c->w, job->sep, job->seplen) == 0)
+        {
+            c->failed = true;
+            return;
+        }
+        const size_t len = ryu_write_double(&c->w, job->values[k], job->fmt);
+        if (len == 0) {
+            c->failed = true;
+            return;
+        }
+        if (job->lens) {
+            job->lens[k] = len;
+        }
+    }
+}
+
+// Copies the buffer of chunk i to its place in the output.
+static void parallel_copy(void* arg, size_t i) {
+    struct parallel_job* job = (struct parallel_job*) arg;
+    struct parallel_chunk* c = &job->chunks[i];
+    if (c->offset < job->avail) {
+        write_partial(job->dst + c->offset, job->avail - c->offset, c->w.buf,
+            c->w.len);
+    }
+    free(c->w.buf);
+}
+
+#endif // RYU_FREESTANDING
+
+RYU_EXTERN
+size_t ryu_string_many_parallel(const double values[], size_t count, 
+    char fmt, const char *sep, char dst[], size_t nbytes, size_t lens[],
+    void (*run)(void *udata, void (*task)(void *arg, size_t i), void *arg, 
+        size_t n),
+    void *udata)
+{
+#ifdef RYU_FREESTANDING
+    // There is no allocator for the chunk buffers.
+    (void) run;
+    (void) udata;
+    return ryu_string_many(values, count, fmt, sep, dst, nbytes, lens);
+#else
+    const size_t nchunks = (count + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+    if (nchunks < 2 || !run || !strchr("eEfgGjJ", fmt) || fmt == '\0') {
+        return ryu_string_many(values, count, fmt, sep, dst, nbytes, lens);
+    }
+    struct parallel_chunk* chunks = (struct parallel_chunk*) calloc(nchunks, 
+        sizeof(struct parallel_chunk));
+    if (!chunks) {
+        return ryu_string_many(values, count, fmt, sep, dst, nbytes, lens);
+    }
+    struct parallel_job job;
+    job.values = values;
+    job.lens = lens;
+    job.fmt = fmt;
+    job.sep = sep;
+    job.seplen = sep ? strlen(sep) : 0;
+    job.dst = dst;
+    job.avail = nbytes > 0 ? nbytes - 1 : 0;
+    job.chunks = chunks;
+    for (size_t i = 0; i < nchunks; i++) {
+        chunks[i].start = i * PARALLEL_CHUNK;
+        chunks[i].count = i < nchunks - 1 ? PARALLEL_CHUNK : 
+            count - chunks[i].start;
+    }
+    run(udata, parallel_format, &job, nchunks);
+    // The output offset of each chunk is the sum of the lengths before it.
+    size_t total = 0;
+    bool failed = false;
+    for (size_t i = 0; i < nchunks; i++) {
+        chunks[i].offset = total;
+        total += chunks[i].w.len;
+        failed |= chunks[i].failed;
+    }
+    if (failed) {
+        // Out of memory, convert on this thread instead.
+        for (size_t i = 0; i < nchunks; i++) {
+            free(chunks[i].w.buf);
+        }
+        free(chunks);
+        return ryu_string_many(values, count, fmt, sep, dst, nbytes, lens);
+    }
+    run(udata, parallel_copy, &job, nchunks);
+    free(chunks);
+    if (nbytes > 0) {
+        dst[total < job.avail ? total : job.avail] = '\0';
+    }
+    return total;
+#endif
+}
+
+RYU_EXTERN
+size_t ryu_parse(const char src[], size_t len, double *d) {
+    return s2d_n(src, len, d);
+}
+
+RYU_EXTERN
+size_t ryu_parse_many(const char src[], size_t len, const char *delims, 
+    double values[], size_t count, size_t *error)
+{
+    bool delim[256] = { false };
+    for (const char *p = delims ? delims : ","; *p; p++) {
+        delim[(uint8_t) *p] = true;
+    }
+    if (error) {
+        *error = len;
+    }
+    size_t n = 0;
+    size_t i = 0;
+    for (;;) {
+        while (i < len && delim[(uint8_t) src[i]]) {
+            i++;
+        }
+        if (i == len) {
+            break;
+        }
+        if (n < count) {
+            const size_t start = i;
+            double d;
+            i += s2d_n(src + i, len - i, &d);
+            if (i == start || (i < len && !delim[(uint8_t) src[i]])) {
+                // Not a number in its entirety.
+                d = int64Bits2Double(0x7ff8ull << 48);
+                if (error && *error == len) {
+                    *error = start;
+                }
+            }
+            values[n] = d;
+        }
+        while (i < len && !delim[(uint8_t) src[i]]) {
+            i++;
+        }
+        n++;
+    }
+    return n;
+}
+
+RYU_EXTERN
+void ryu_read_stats(struct ryu_stats *stats, bool reset) {
+#ifdef RYU_STATS
+    *stats = thread_stats;
+    if (reset) {
+        memset(&thread_stats, 0, sizeof(thread_stats));
+    }
+#else
+    (void) reset;
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+RYU_EXTERN
+void ryu_read_profile(struct ryu_profile *profile, bool reset) {
+#ifdef RYU_PROFILE
+    *profile = thread_profile;
+    if (reset) {
+        memset(&thread_profile, 0, sizeof(thread_profile));
+    }
+#else
+    (void) reset;
+    memset(profile, 0, sizeof(*profile));
+#endif
+}
+
+#define PROFILE_LINE 80
+
+// Appends the len bytes of text to the line, padded on the left to width
+// characters when right is set, and on the right otherwise.
+static size_t profile_column(char line[], size_t n, const char *text, 
+    size_t len, size_t width, bool right)
+{
+    const size_t pad = len < width ? width - len : 0;
+    if (right) {
+        memset(line + n, ' ', pad);
+        n += pad;
+    }
+    memcpy(line + n, text, len);
+    n += len;
+    if (!right) {
+        memset(line + n, ' ', pad);
+        n += pad;
+    }
+    return n;
+}
+
+static size_t profile_number(char line[], size_t n, uint64_t value, 
+    size_t width)
+{
+    char buf[INT_MAX_LENGTH];
+    const size_t len = print_int(value, false, buf, sizeof(buf));
+    return profile_column(line, n, buf, len, width, true);
+}
+
+// Appends the upper bound of the histogram bucket that holds fraction
+// num / den of the calls, or the lower bound and a "+" for the last bucket.
+static size_t profile_percentile(char line[], size_t n, 
+    const struct ryu_profile_stage *s, uint64_t num, uint64_t den)
+{
+    const uint64_t rank = (s->count * num + den - 1) / den;
+    uint64_t seen = 0;
+    uint32_t b = 0;
+    while (b < RYU_PROFILE_BUCKETS - 1) {
+        seen += s->histogram[b];
+        if (seen >= rank) {
+            break;
+        }
+        b++;
+    }
+    if (b < RYU_PROFILE_BUCKETS - 1) {
+        return profile_number(line, n, 1ull << b, 9);
+    }
+    char buf[INT_MAX_LENGTH + 1];
+    size_t len = print_int(1ull << (b - 1), false, buf, sizeof(buf));
+    buf[len++] = '+';
+    return profile_column(line, n, buf, len, 9, true);
+}
+
+// Appends one row of the dump, with the calls, ticks and percentiles of s.
+static size_t profile_row(char dst[], size_t avail, size_t total, 
+    const char *format, const char *stage, const struct ryu_profile_stage *s)
+{
+    const uint64_t count = s->count;
+    char line[PROFILE_LINE];
+    size_t n = 0;
+    n = profile_column(line, n, format, strlen(format), 7, false);
+    n = profile_column(line, n, stage, strlen(stage), 7, false);
+    n = profile_number(line, n, count, 12);
+    // The mean, with one decimal.
+    const uint64_t mean10 = count > 0 ? s->ticks * 10 / count : 0;
+    n = profile_number(line, n, mean10 / 10, 10);
+    line[n++] = '.';
+    line[n++] = (char) ('0' + mean10 % 10);
+    n = profile_percentile(line, n, s, 1, 2);
+    n = profile_percentile(line, n, s, 9, 10);
+    n = profile_percentile(line, n, s, 99, 100);
+    line[n++] = '\n';
+    const size_t pos = total < avail ? total : avail;
+    return write_partial(dst + pos, avail - pos, line, n);
+}
+
+RYU_EXTERN
+size_t ryu_profile_dump(const struct ryu_profile *profile, char dst[], 
+    size_t nbytes)
+{
+    static const char *const formats[RYU_PROFILE_FORMATS] = { 
+        "e", "E", "f", "g", "G", "j", "J", "other" 
+    };
+    static const char *const stages[RYU_PROFILE_STAGES] = { 
+        "decode", "d2d", "print", "total", "rest" 
+    };
+    static const char header[] = 
+        "format stage         calls  ticks/call      p50      p90      p99\n";
+    const size_t avail = nbytes > 0 ? nbytes - 1 : 0;
+    size_t total = write_partial(dst, avail, header, sizeof(header) - 1);
+    for (uint32_t i = 0; i < RYU_PROFILE_FORMATS; i++) {
+        const struct ryu_profile_stage *s = profile->stages[i];
+        for (uint32_t k = 0; k < RYU_PROFILE_STAGES; k++) {
+            if (s[k].count > 0) {
+                total += profile_row(dst, avail, total, formats[i], 
+                    stages[k], &s[k]);
+            }
+        }
+    }
+    if (nbytes > 0) {
+        dst[total < avail ? total : avail] = '\0';
+    }
+    return total;
+}
+
+#ifdef RYU_FREESTANDING
+// For files that include ryu.c, and the C library after it.
+#undef assert
+#undef memcpy
+#undef memmove
+#undef memset
+#undef memcmp
+#undef memchr
+#undef strlen
+#undef strchr
+#endif
@@ -2,6 +2,135 @@
 #define RYU_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <float.h>
+
+#if LDBL_MANT_DIG == 53 || (defined(__SIZEOF_INT128__) && \
+    !defined(_MSC_VER) && ((LDBL_MANT_DIG == 64 && \
+    (defined(__i386__) || defined(__x86_64__))) || LDBL_MANT_DIG == 113))
+#define RYU_HAS_LONG_DOUBLE
+#endif
+
+#ifndef RYU_VALUE_DEFINED
+#define RYU_VALUE_DEFINED
+// A double, or a float, decoded into its shortest decimal representation.
+// The fields are private, use the ryu_value_* functions.
+struct ryu_value {
+    uint64_t mantissa;
+    int32_t exponent;
+    bool sign;
+    bool finite;
+};
+#endif
+
+#ifndef RYU_WRITER_DEFINED
+#define RYU_WRITER_DEFINED
+// A streaming writer that appends into the caller-owned buffer buf, which
+// holds cap bytes, of which the first len are written.
+struct ryu_writer {
+    char *buf;
+    size_t cap;
+    size_t len;
+    // Called when the next write of need bytes does not fit. It should make
+    // room, by growing buf and cap, or by consuming buf and resetting len.
+    // Returns false to fail the write. May be NULL.
+    bool (*flush)(struct ryu_writer *w, size_t need);
+    // Caller data for flush, not used by ryu.
+    void *udata;
+};
+#endif
+
+#ifndef RYU_OPTIONS_DEFINED
+#define RYU_OPTIONS_DEFINED
+// Options for ryu_string_options. A zeroed struct is the 'j' format.
+struct ryu_options {
+    // One of the ryu_string formats, or 'j' when zero.
+    char format;
+    // The decimal point, or '.' when zero.
+    char point;
+    // The exponent character, or the case of the format when zero.
+    char exponent;
+    // '+' to sign every exponent, '-' to sign only negative exponents, or
+    // the sign of the format when zero.
+    char exponent_sign;
+    // Suffix integral outputs without an exponent with ".0", as in "5.0".
+    bool dotzero;
+    // The outputs for NaN and infinities, or "NaN", "Infinity" and
+    // "-Infinity" when NULL.
+    const char *nan;
+    const char *infinity;
+    const char *neg_infinity;
+};
+#endif
+
+#ifndef RYU_SERIES_DEFINED
+#define RYU_SERIES_DEFINED
+// The longest output that a ryu_series keeps for the next value.
+#define RYU_SERIES_TEXT 32
+
+// The state of ryu_series_string, for the consecutive values of one series.
+// A zeroed struct, with the format set, starts a new series. The other
+// fields are internal.
+struct ryu_series {
+    // One of the ryu_string formats, or 'j' when zero.
+    char fmt;
+    // The previous value and its output, which is kept when it fits in text,
+    // and the format it was printed in.
+    bool cached;
+    char textfmt;
+    bool sign;
+    // The number of digits of mantissa, or 0 when they can't be rewritten.
+    uint8_t olength;
+    // The digits are at start, with the decimal point after split of them.
+    uint8_t start;
+    uint8_t split;
+    uint8_t len;
+    int32_t exponent;
+    uint64_t bits;
+    uint64_t mantissa;
+    char text[RYU_SERIES_TEXT];
+};
+#endif
+
+#ifndef RYU_STATS_DEFINED
+#define RYU_STATS_DEFINED
+// Counts of the conversion paths taken by one thread.
+struct ryu_stats {
+    uint64_t special;        // NaN and infinities
+    uint64_t zero;           // positive and negative zero
+    uint64_t small_int;      // integers below 2^53, without d2d
+    uint64_t general;        // d2d, and f2d for floats
+    uint64_t trailing_zeros; // the rare d2d and f2d trailing zeros case
+    uint64_t fixed;          // 'g' and 'j' outputs without an exponent
+    uint64_t exponent;       // 'g' and 'j' outputs with an exponent
+};
+#endif
+
+#ifndef RYU_PROFILE_DEFINED
+#define RYU_PROFILE_DEFINED
+// The stages timed by RYU_PROFILE.
+#define RYU_PROFILE_DECODE 0 // the bits to a decimal, without d2d
+#define RYU_PROFILE_D2D 1    // d2d, the shortest digits and their exponent
+#define RYU_PROFILE_PRINT 2  // print_options, the digits and the form
+#define RYU_PROFILE_TOTAL 3  // a whole ryu_string or ryu_write_double call
+#define RYU_PROFILE_REST 4   // the ticks of each total outside of the stages
+#define RYU_PROFILE_STAGES 5
+// The formats "eEfgGjJ", and then every other entry point.
+#define RYU_PROFILE_FORMATS 8
+#define RYU_PROFILE_BUCKETS 16
+// The ticks of one stage in one format.
+struct ryu_profile_stage {
+    uint64_t count;
+    uint64_t ticks;
+    // Bucket 0 counts the calls that took no ticks, bucket i those that took
+    // from 2^(i-1) to 2^i - 1, and the last bucket every longer call.
+    uint64_t histogram[RYU_PROFILE_BUCKETS];
+};
+struct ryu_profile {
+    struct ryu_profile_stage stages[RYU_PROFILE_FORMATS][RYU_PROFILE_STAGES];
+};
+#endif
 
 // ryu_string converts a double into a string representation that is copied
 // into the provided C string buffer.
@@ -21,4 +150,303 @@
 //   'J' ('G' for large exponents, 'f' otherwise) (matches javascript format)
 size_t ryu_string(double d, char fmt, char dst[], size_t nbytes);
 
+// ryu_string_e, ryu_string_E, ryu_string_f, ryu_string_g, ryu_string_G,
+// ryu_string_j and ryu_string_J are ryu_string with a fixed format, for
+// callers that know the format at compile time. Each is specialized for its
+// format, with no format switch.
+size_t ryu_string_e(double d, char dst[], size_t nbytes);
+size_t ryu_string_E(double d, char dst[], size_t nbytes);
+size_t ryu_string_f(double d, char dst[], size_t nbytes);
+size_t ryu_string_g(double d, char dst[], size_t nbytes);
+size_t ryu_string_G(double d, char dst[], size_t nbytes);
+size_t ryu_string_j(double d, char dst[], size_t nbytes);
+size_t ryu_string_J(double d, char dst[], size_t nbytes);
+
+// ryu_string_f32 converts a float into a string representation that is
+// copied into the provided C string buffer. The output is the shortest
+// representation of the float itself, e.g. 0.1f is "0.1", and not that of
+// the double it widens to.
+//
+// The return value and format are the same as ryu_string.
+size_t ryu_string_f32(float f, char fmt, char dst[], size_t nbytes);
+
+// ryu_string_f16 and ryu_string_bf16 convert the bits of an IEEE
+// half-precision float (fp16) or of a bfloat16 into a string representation
+// that is copied into the provided C string buffer. The output is the
+// shortest representation of the 16-bit value itself, e.g. the fp16 0x2e66
+// is "0.1", and not that of the float it widens to.
+//
+// The return value and format are the same as ryu_string.
+size_t ryu_string_f16(uint16_t h, char fmt, char dst[], size_t nbytes);
+size_t ryu_string_bf16(uint16_t b, char fmt, char dst[], size_t nbytes);
+
+// ryu_string_ld and ryu_string_f128 convert a long double or a __float128
+// into a string representation that is copied into the provided C string
+// buffer, with the shortest digits of the wider value, e.g. 0.1L is "0.1".
+// Exponents can have four digits, and the fixed form of a large or tiny
+// value can be thousands of characters long.
+//
+// ryu_string_ld is declared where RYU_HAS_LONG_DOUBLE is defined: when a long
+// double is a double, or the compiler has 128-bit integers and a long double
+// is the x87 80-bit format or IEEE binary128. ryu_string_f128 needs 128-bit
+// integers and __float128.
+//
+// The return value and format are the same as ryu_string.
+#if defined(RYU_HAS_LONG_DOUBLE)
+size_t ryu_string_ld(long double x, char fmt, char dst[], size_t nbytes);
+#endif
+#if defined(__SIZEOF_INT128__) && !defined(_MSC_VER) && \
+    defined(__SIZEOF_FLOAT128__)
+size_t ryu_string_f128(__float128 x, char fmt, char dst[], size_t nbytes);
+#endif
+
+// ryu_string_precision converts a double into a string representation with
+// a fixed number of digits after the decimal point, like printf's "%.*f" and
+// "%.*e". The value is rounded exactly, with ties going to the even digit.
+//
+// The format is one of
+//   'e' (-d.ddde+dd, precision digits after the point, at least two exponent
+//        digits)
+//   'E' (-d.dddE+dd, precision digits after the point, at least two exponent
+//        digits)
+//   'f' (-ddd.ddd, precision digits after the point)
+//
+// The return value is the same as ryu_string. NaN and infinities are written
+// as "NaN", "Infinity" and "-Infinity".
+size_t ryu_string_precision(double d, char fmt, unsigned precision, 
+    char dst[], size_t nbytes);
+
+// ryu_length returns the number of characters, not including the
+// null-terminator, that ryu_string writes for d in the format fmt. Nothing is
+// formatted. This is the same as ryu_string(d, fmt, NULL, 0).
+size_t ryu_length(double d, char fmt);
+
+// ryu_decode decodes a double into its shortest decimal representation,
+// which is the expensive part of a conversion. The value can then be sized
+// with ryu_value_length and printed with ryu_value_string, in any format,
+// without decoding it again.
+struct ryu_value ryu_decode(double d);
+
+// ryu_decode_f32 is ryu_decode for a float. The value is the shortest
+// representation of the float, like ryu_string_f32.
+struct ryu_value ryu_decode_f32(float f);
+
+// ryu_decode_f16 and ryu_decode_bf16 are ryu_decode for the bits of an fp16
+// or a bfloat16, like ryu_string_f16 and ryu_string_bf16.
+struct ryu_value ryu_decode_f16(uint16_t h);
+struct ryu_value ryu_decode_bf16(uint16_t b);
+
+// ryu_value_length returns the number of characters, not including the
+// null-terminator, that ryu_value_string writes for v in the format fmt.
+size_t ryu_value_length(struct ryu_value v, char fmt);
+
+// ryu_value_string converts a decoded value into a string representation
+// that is copied into the provided C string buffer.
+//
+// The return value and format are the same as ryu_string.
+size_t ryu_value_string(struct ryu_value v, char fmt, char dst[], 
+    size_t nbytes);
+
+// ryu_decompose decodes a double into the shortest decimal that round trips,
+// such that d is *mantissa * 10^*exponent, negated when *sign is set. The
+// mantissa has no trailing zeros, and zero is a mantissa and exponent of 0.
+//
+// Returns false for NaN and infinities, in which case *exponent is 0 and
+// *mantissa is non-zero only for NaN.
+bool ryu_decompose(double d, uint64_t *mantissa, int32_t *exponent, 
+    bool *sign);
+
+// ryu_write_double appends the string representation of a double to the
+// streaming writer w, with no null-terminator. The flush callback is called
+// first when the output does not fit into the remaining capacity, so values
+// are never partially written.
+//
+// Returns the number of bytes appended, or zero if the value did not fit or
+// the format is invalid. The format is the same as ryu_string.
+size_t ryu_write_double(struct ryu_writer *w, double d, char fmt);
+
+// ryu_write_bytes appends len bytes from src, such as a separator, to the
+// streaming writer w. Returns the number of bytes appended, or zero if they
+// did not fit.
+size_t ryu_write_bytes(struct ryu_writer *w, const char *src, size_t len);
+
+// ryu_string_many converts an array of doubles into string representations
+// that are copied, one after another, into the provided C string buffer.
+// Each string is separated by sep, which may be NULL for no separator.
+//
+// Returns the number of characters, not including the null-terminator, needed
+// to store all of the strings into the C string buffer.
+// If the returned length is greater than nbytes-1, then only a parital copy
+// occurred.
+//
+// If lens is not NULL, then it must have room for count entries, and the
+// length of each string, not including the separator, is stored in lens[i].
+// The lengths are always complete, even when a parital copy occurred.
+//
+// The format is the same as ryu_string.
+size_t ryu_string_many(const double values[], size_t count, char fmt,
+    const char *sep, char dst[], size_t nbytes, size_t lens[]);
+
+// ryu_string_many_f16 and ryu_string_many_bf16 are ryu_string_many for
+// arrays of fp16 or bfloat16 bits, which are printed like ryu_string_f16 and
+// ryu_string_bf16.
+size_t ryu_string_many_f16(const uint16_t values[], size_t count, char fmt,
+    const char *sep, char dst[], size_t nbytes, size_t lens[]);
+size_t ryu_string_many_bf16(const uint16_t values[], size_t count, char fmt,
+    const char *sep, char dst[], size_t nbytes, size_t lens[]);
+
+// ryu_json_array converts an array of doubles into a JSON array, such as
+// "[1.5,-0.25,1e+21]", that is copied into the provided C string buffer.
+// The numbers use the 'j' format. NaN and infinities, which JSON does not
+// have, are written as special, or as "null" when special is NULL.
+//
+// The return value is the same as ryu_string.
+size_t ryu_json_array(const double values[], size_t count, 
+    const char *special, char dst[], size_t nbytes);
+
+// ryu_csv_row converts an array of doubles into a CSV row, such as
+// "1.5,-0.25,1e+21", that is copied into the provided C string buffer. The
+// values are separated by sep and use the 'j' format. NaN and infinities are
+// written as special, or as "NaN", "Infinity" and "-Infinity" when special
+// is NULL. No line ending is added.
+//
+// The return value is the same as ryu_string.
+size_t ryu_csv_row(const double values[], size_t count, char sep,
+    const char *special, char dst[], size_t nbytes);
+
+// ryu_string_options is ryu_string with the output options in opts, which
+// may be NULL for the defaults. The options are applied as the output is
+// written, which is in one pass, and do not change whether a value is
+// printed in fixed-point or exponent form. An invalid format is written as
+// an empty string.
+//
+// The return value is the same as ryu_string.
+size_t ryu_string_options(double d, const struct ryu_options *opts, 
+    char dst[], size_t nbytes);
+
+// ryu_string_many_options is ryu_string_many with the output options in
+// opts, which are resolved once for the whole batch.
+size_t ryu_string_many_options(const double values[], size_t count, 
+    const struct ryu_options *opts, const char *sep, char dst[], 
+    size_t nbytes, size_t lens[]);
+
+// ryu_u64 and ryu_i64 convert an integer into a decimal string, such as
+// "-9223372036854775808", that is copied into the provided C string buffer.
+// The digits are printed by the same code as the digits of a double.
+//
+// The return value is the same as ryu_string.
+size_t ryu_u64(uint64_t v, char dst[], size_t nbytes);
+size_t ryu_i64(int64_t v, char dst[], size_t nbytes);
+
+// ryu_u64_many and ryu_i64_many are ryu_string_many for arrays of integers,
+// which are printed like ryu_u64 and ryu_i64.
+size_t ryu_u64_many(const uint64_t values[], size_t count, const char *sep,
+    char dst[], size_t nbytes, size_t lens[]);
+size_t ryu_i64_many(const int64_t values[], size_t count, const char *sep,
+    char dst[], size_t nbytes, size_t lens[]);
+
+// ryu_write_u64 and ryu_write_i64 append an integer, printed like ryu_u64
+// and ryu_i64, to the streaming writer w. The return value is the same as
+// ryu_write_double.
+size_t ryu_write_u64(struct ryu_writer *w, uint64_t v);
+size_t ryu_write_i64(struct ryu_writer *w, int64_t v);
+
+// ryu_series_string converts the next value d of a series, such as the
+// timestamps or gauges of a metrics exporter, like ryu_string in the format
+// s->fmt. The previous output is kept in s and reused when d is the same,
+// or has the same sign, exponent and number of digits, in which case only
+// the low digits that changed are rewritten. The output is always the same
+// as ryu_string, also when s->fmt is changed between values.
+//
+// The return value is the same as ryu_string.
+size_t ryu_series_string(struct ryu_series *s, double d, char dst[], 
+    size_t nbytes);
+
+// ryu_write_series appends the next value d of the series s, printed like
+// ryu_series_string, to the streaming writer w. The return value is the same
+// as ryu_write_double.
+size_t ryu_write_series(struct ryu_writer *w, struct ryu_series *s, double d);
+
+// ryu_string_many_parallel is ryu_string_many for very large arrays. The
+// values are split into chunks that are converted by the run callback,
+// which must call task(arg, i) once for every i in [0, n), on any threads,
+// and return when all of the calls are done. The output is the same as
+// ryu_string_many. The udata is passed to run.
+//
+// Each chunk is converted into its own buffer, which is then copied into
+// dst, so the memory for the output is allocated temporarily. Small arrays,
+// a NULL run, and allocation failures fall back to ryu_string_many,
+// as does every call in a RYU_FREESTANDING build.
+size_t ryu_string_many_parallel(const double values[], size_t count, 
+    char fmt, const char *sep, char dst[], size_t nbytes, size_t lens[],
+    void (*run)(void *udata, void (*task)(void *arg, size_t i), void *arg, 
+        size_t n),
+    void *udata);
+
+// ryu_parse converts the string representation of a double at the start of
+// src into a double. Every format written by ryu_string is accepted,
+// including "NaN", "Infinity" and exponents with a '+' sign. Parsing does not
+// depend on the locale.
+//
+// Returns the number of bytes consumed from src, which is zero if src does not
+// start with a number. Parsing stops at the first byte that is not part of
+// the number, so src does not need to be null-terminated.
+// Numbers with more than 17 significant digits are not supported, and are
+// reported as not being a number.
+size_t ryu_parse(const char src[], size_t len, double *d);
+
+// ryu_parse_many parses the numbers in the len bytes of src, which are
+// separated by runs of the bytes in delims, such as "," or ", \n", into
+// values. A NULL delims is ",". Delimiters at the start and end of src are
+// skipped, so the output of ryu_string_many and ryu_csv_row can be read back
+// with its separator as delims.
+//
+// Every token is parsed like ryu_parse. A token that is not a number in its
+// entirety is stored as NaN and parsing continues with the next token. If
+// error is not NULL, it is set to the offset in src of the first such token,
+// or to len if every token was a number.
+//
+// Returns the number of tokens in src. No more than count values are stored,
+// and the tokens beyond them are counted but not parsed, so a NULL values
+// and a zero count returns how many values are needed.
+size_t ryu_parse_many(const char src[], size_t len, const char *delims, 
+    double values[], size_t count, size_t *error);
+
+// ryu_read_stats copies the path counters of the calling thread into stats,
+// and zeroes them if reset is set. Every shortest conversion counts one of
+// special, zero, small_int and general, and a finite value in 'g' or 'j'
+// counts one of fixed and exponent, also when only its length is asked for.
+// The exact digits of ryu_string_precision and the integers of ryu_u64 and
+// ryu_i64 are not counted. The chunks of ryu_string_many_parallel are
+// counted on the threads that convert them.
+//
+// The counters are only kept when ryu.c is compiled with -DRYU_STATS, and
+// are all zero otherwise.
+void ryu_read_stats(struct ryu_stats *stats, bool reset);
+
+// ryu_read_profile copies the stage timings of the calling thread into
+// profile, and zeroes them if reset is set. Each call of ryu_string and
+// ryu_write_double is timed as a whole, and the decoding, d2d and printing
+// stages within it, in ticks of the time stamp counter on x86 and of the
+// virtual counter on AArch64. The rest stage of each call is the part of
+// its total outside of the other stages, such as the small integer path and
+// the null-terminator. The stages of ryu_string_many are counted for its
+// format without a total or rest, and those of every other function under
+// "other". Reading the counter takes a few tens of cycles on x86, which is
+// included in the stages it ends.
+//
+// The timings are only kept when ryu.c is compiled with -DRYU_PROFILE, and
+// are all zero otherwise.
+void ryu_read_profile(struct ryu_profile *profile, bool reset);
+
+// ryu_profile_dump prints profile as a table, with a row for every stage
+// that was timed in each format: the calls, the mean ticks per call, and the
+// 50th, 90th and 99th percentiles, which are the upper bounds of their
+// histogram buckets.
+//
+// The output is null-terminated and truncated to nbytes like ryu_string,
+// and the full length is returned.
+size_t ryu_profile_dump(const struct ryu_profile *profile, char dst[], 
+    size_t nbytes);
+
 #endif
@@ -16,6 +16,47 @@
     } \
 }
 
+#define test_f32(fmt, input, expected) { \
+    char buf[256]; \
+    ryu_string_f32((input), (fmt), buf, sizeof(buf)); \
+    if (strcmp(buf, (expected)) != 0) { \
+        fprintf(stderr, "line %d: expected %s, got %s\n", \
+            __LINE__, (expected), buf); \
+        exit(1); \
+    } \
+}
+
+#define test_fn(fn, fmt, input, expected) { \
+    char buf[256]; \
+    fn((input), (fmt), buf, sizeof(buf)); \
+    if (strcmp(buf, (expected)) != 0) { \
+        fprintf(stderr, "line %d: expected %s, got %s\n", \
+            __LINE__, (expected), buf); \
+        exit(1); \
+    } \
+}
+
+#define test_parse(input, expected, nconsumed) { \
+    double d = 0; \
+    size_t n = ryu_parse((input), strlen(input), &d); \
+    if (n != (nconsumed) || memcmp(&d, &(double){(expected)}, 8) != 0) { \
+        fprintf(stderr, "line %d: expected %.17g (%d), got %.17g (%d)\n", \
+            __LINE__, (double)(expected), (int)(nconsumed), d, (int)n); \
+        exit(1); \
+    } \
+}
+
+#define test_prec(fmt, precision, input, expected) { \
+    char buf[2048]; \
+    size_t n = ryu_string_precision((input), (fmt), (precision), buf, \
+        sizeof(buf)); \
+    if (strcmp(buf, (expected)) != 0 || n != strlen(expected)) { \
+        fprintf(stderr, "line %d: expected %s, got %s\n", \
+            __LINE__, (expected), buf); \
+        exit(1); \
+    } \
+}
+
 #define test_j(input) { \
     char buf0[256]; \
     strcpy(buf0, #input); \
@@ -34,6 +75,30 @@
     } \
 }
 
+static char sink[256];
+static size_t sinklen;
+
+// Moves the writer's buffer into sink.
+static bool flush_sink(struct ryu_writer *w, size_t need) {
+    if (need > w->cap) {
+        return false;
+    }
+    memcpy(sink + sinklen, w->buf, w->len);
+    sinklen += w->len;
+    w->len = 0;
+    return true;
+}
+
+// Runs the tasks on this thread, last to first.
+static void run_reversed(void *udata, void (*task)(void *arg, size_t i), 
+    void *arg, size_t n)
+{
+    (void)udata;
+    for (size_t i = n; i > 0; i--) {
+        task(arg, i - 1);
+    }
+}
+
 int main(void) {
     // test_j(5.307740298202583E+22);
     // // test('j', 5.307740298202583E+22, "5.307740298202583E+22");
@@ -66,6 +131,13 @@ int main(void) {
     test('f', 5123.0, "5123");
     test('f', 5000000000000000000.0, "5000000000000000000");
     test('f', -0.00000000000000005, "-0.00000000000000005");
+    test('f', 1e-7, "0.0000001");
+    test('f', 123.456, "123.456");
+    test('f', 1e22, "10000000000000000000000");
+    test('f', -1.5e-10, "-0.00000000015");
+    test('f', INFINITY, "Infinity");
+    test('f', -INFINITY, "-Infinity");
+    test('f', NAN, "NaN");
     char buf[32];
     size_t n1 = ryu_string(-112.89123883, 'f', buf, sizeof(buf));
     assert(strcmp(buf, "-112.89123883") == 0);
@@ -81,6 +153,403 @@ int main(void) {
     ryu_string(-112.89123883, 'f', buf, 6);
     assert(strcmp(buf, "-112.") == 0);
     test('g', -0.01, "-0.01");
+    test_f32('f', 0.1f, "0.1");
+    test_f32('e', 0.1f, "1e-1");
+    test_f32('f', -1.5f, "-1.5");
+    test_f32('f', 16777216.0f, "16777216");
+    test_f32('g', 3.4028235e38f, "3.4028235e38");
+    test_f32('j', 3.4028235e38f, "3.4028235e+38");
+    test_f32('J', 1e-45f, "1E-45");
+    test_f32('f', 1.17549435e-38f, 
+        "0.000000000000000000000000000000000000011754944");
+    test_f32('f', 0.0f, "0");
+    test_f32('e', -0.0f, "-0e0");
+    test_f32('f', -INFINITY, "-Infinity");
+    test_f32('j', NAN, "NaN");
+    test_fn(ryu_string_f16, 'f', 0x2e66, "0.1");
+    test_fn(ryu_string_f16, 'f', 0x7bff, "65500");
+    test_fn(ryu_string_f16, 'j', 0x0001, "0.00000006");
+    test_fn(ryu_string_f16, 'e', 0x0400, "6.104e-5");
+    test_fn(ryu_string_f16, 'f', 0xbc00, "-1");
+    test_fn(ryu_string_f16, 'e', 0x8000, "-0e0");
+    test_fn(ryu_string_f16, 'f', 0xfc00, "-Infinity");
+    test_fn(ryu_string_f16, 'j', 0x7e00, "NaN");
+    test_fn(ryu_string_bf16, 'f', 0x3dcd, "0.1");
+    test_fn(ryu_string_bf16, 'j', 0x7f7f, "3.39e+38");
+    test_fn(ryu_string_bf16, 'e', 0x0001, "1e-40");
+    test_fn(ryu_string_bf16, 'f', 0x4049, "3.14");
+    test_fn(ryu_string_bf16, 'f', 0x7f80, "Infinity");
+    test_fn(ryu_string_bf16, 'J', 0x7fc0, "NaN");
+    assert(ryu_string_f16(0x3c00, 'x', NULL, 0) == 0);
+#if defined(RYU_HAS_LONG_DOUBLE)
+    test_fn(ryu_string_ld, 'f', 0.1L, "0.1");
+    test_fn(ryu_string_ld, 'g', 123456.75L, "123456.75");
+    test_fn(ryu_string_ld, 'j', -0.0L, "-0");
+    assert(ryu_string_ld(1.0L, 'x', NULL, 0) == 0);
+#if LDBL_MANT_DIG == 64
+    test_fn(ryu_string_ld, 'e', 1.0L / 3, "3.3333333333333333334e-1");
+    test_fn(ryu_string_ld, 'e', LDBL_MAX, "1.189731495357231765e4932");
+    test_fn(ryu_string_ld, 'j', 1e4000L, "1e+4000");
+    {
+        char lbuf[8];
+        assert(ryu_string_ld(1e-4000L, 'f', lbuf, sizeof(lbuf)) == 4002);
+        assert(strcmp(lbuf, "0.00000") == 0);
+    }
+#endif
+#endif
+#if defined(__SIZEOF_INT128__) && !defined(_MSC_VER) && \
+    defined(__SIZEOF_FLOAT128__)
+    test_fn(ryu_string_f128, 'f', (__float128) 1 / 10, "0.1");
+    test_fn(ryu_string_f128, 'e', (__float128) 1 / 3, 
+        "3.333333333333333333333333333333333e-1");
+    test_fn(ryu_string_f128, 'j', (__float128) 1e16 * 1e16, "1e+32");
+    test_fn(ryu_string_f128, 'f', -__builtin_infq(), "-Infinity");
+#endif
+    test_parse("1.5", 1.5, 3);
+    test_parse("-0.015", -0.015, 6);
+    test_parse("-0", -0.0, 2);
+    test_parse("5e+21", 5e21, 5);
+    test_parse("5E-324", 5e-324, 6);
+    test_parse("2.1212312312318882e8", 212123123.123188832, 20);
+    test_parse("9223372036854776000", 9223372036854775808.0, 19);
+    test_parse("0.00000000000000005", 0.00000000000000005, 19);
+    test_parse("1.7976931348623157e308", 1.7976931348623157e308, 22);
+    test_parse("1e309", INFINITY, 5);
+    test_parse("-Infinity", -INFINITY, 9);
+    test_parse("12,34", 12.0, 2);
+    test_parse("1e", 1.0, 1);
+    test_parse("e1", 0.0, 0);
+    test_parse("-", 0.0, 0);
+    test_parse("123456789012345678", 0.0, 0);
+    test_parse("1234567890123456700000", 1.2345678901234567e21, 22);
+    test_parse("0.123456789012345678", 0.0, 0);
+    test_parse("0.00000000123456789012", 1.23456789012e-9, 22);
+    test_parse("12345678.87654321e-8", 0.1234567887654321, 20);
+    const char *ptext = " 1.5,-0.25, 1e+21,x,NaN,,-Infinity,7 ";
+    double tvals[8];
+    size_t perr;
+    assert(ryu_parse_many(ptext, strlen(ptext), ", ", tvals, 8, &perr) == 7);
+    assert(tvals[0] == 1.5 && tvals[1] == -0.25 && tvals[2] == 1e21);
+    assert(isnan(tvals[3]) && isnan(tvals[4]) && tvals[5] == -INFINITY);
+    assert(tvals[6] == 7.0 && perr == 18);
+    assert(ryu_parse_many(ptext, strlen(ptext), ", ", NULL, 0, NULL) == 7);
+    assert(ryu_parse_many(ptext, strlen(ptext), ", ", tvals, 2, &perr) == 7);
+    assert(perr == strlen(ptext));
+    assert(ryu_parse_many("1;2x;3", 6, ";", tvals, 8, &perr) == 3);
+    assert(tvals[0] == 1.0 && isnan(tvals[1]) && tvals[2] == 3.0);
+    assert(perr == 2);
+    assert(ryu_parse_many("", 0, NULL, tvals, 8, &perr) == 0 && perr == 0);
+    double dnan;
+    assert(ryu_parse("NaN", 3, &dnan) == 3 && isnan(dnan));
+    double vals[] = { 1.5, -0.25, 1e21, NAN };
+    size_t lens[4];
+    char mbuf[64];
+    size_t nm = ryu_string_many(vals, 4, 'j', ",", mbuf, sizeof(mbuf), lens);
+    assert(strcmp(mbuf, "1.5,-0.25,1e+21,NaN") == 0);
+    assert(nm == strlen(mbuf));
+    assert(lens[0] == 3 && lens[1] == 5 && lens[2] == 5 && lens[3] == 3);
+    assert(ryu_string_many(vals, 4, 'j', ",", NULL, 0, NULL) == nm);
+    assert(ryu_string_many(vals, 4, 'j', ",", mbuf, 8, lens) == nm);
+    assert(strcmp(mbuf, "1.5,-0.") == 0);
+    assert(lens[2] == 5);
+    assert(ryu_string_many(vals, 2, 'e', NULL, mbuf, sizeof(mbuf), NULL) == 12);
+    assert(strcmp(mbuf, "1.5e0-2.5e-1") == 0);
+    const uint16_t hvals[] = { 0x3c00, 0xb800, 0x7c00, 0x0000 };
+    size_t hlens[4];
+    assert(ryu_string_many_f16(hvals, 4, 'j', ",", mbuf, sizeof(mbuf), 
+        hlens) == 17);
+    assert(strcmp(mbuf, "1,-0.5,Infinity,0") == 0);
+    assert(hlens[0] == 1 && hlens[1] == 4 && hlens[2] == 8 && hlens[3] == 1);
+    const uint16_t bvals[] = { 0x3f80, 0xbfc0 };
+    assert(ryu_string_many_bf16(bvals, 2, 'e', " ", mbuf, sizeof(mbuf), 
+        NULL) == 10);
+    assert(strcmp(mbuf, "1e0 -1.5e0") == 0);
+    assert(ryu_string_many_f16(hvals, 4, 'x', ",", mbuf, sizeof(mbuf), 
+        hlens) == 0);
+    assert(mbuf[0] == '\0' && hlens[3] == 0);
+    double cvals[] = { 5000.0, -0.0, -INFINITY, -42.0, 0.5 };
+    ryu_string_many(cvals, 5, 'f', " ", mbuf, sizeof(mbuf), NULL);
+    assert(strcmp(mbuf, "5000 -0 -Infinity -42 0.5") == 0);
+    ryu_string_many(cvals, 5, 'E', " ", mbuf, sizeof(mbuf), NULL);
+    assert(strcmp(mbuf, "5E3 -0E0 -Infinity -4.2E1 5E-1") == 0);
+    ryu_string_many(cvals, 5, 'g', " ", mbuf, sizeof(mbuf), NULL);
+    assert(strcmp(mbuf, "5e3 -0 -Infinity -42 0.5") == 0);
+    assert(ryu_json_array(vals, 4, NULL, mbuf, sizeof(mbuf)) == 22);
+    assert(strcmp(mbuf, "[1.5,-0.25,1e+21,null]") == 0);
+    ryu_json_array(cvals, 5, "\"-inf\"", mbuf, sizeof(mbuf));
+    assert(strcmp(mbuf, "[5000,-0,\"-inf\",-42,0.5]") == 0);
+    ryu_json_array(vals, 0, NULL, mbuf, sizeof(mbuf));
+    assert(strcmp(mbuf, "[]") == 0);
+    assert(ryu_json_array(vals, 4, NULL, mbuf, 6) == 22);
+    assert(strcmp(mbuf, "[1.5,") == 0);
+    assert(ryu_csv_row(vals, 4, ';', NULL, mbuf, sizeof(mbuf)) == 19);
+    assert(strcmp(mbuf, "1.5;-0.25;1e+21;NaN") == 0);
+    ryu_csv_row(vals, 4, ',', "", mbuf, sizeof(mbuf));
+    assert(strcmp(mbuf, "1.5,-0.25,1e+21,") == 0);
+    size_t pcount = 10000;
+    double *pvals = malloc(pcount * sizeof(double));
+    size_t *plens = malloc(pcount * sizeof(size_t));
+    for (size_t i = 0; i < pcount; i++) {
+        pvals[i] = i % 7 == 0 ? NAN : (double)i * (i % 2 ? -0.25 : 1e19);
+    }
+    size_t plen = ryu_string_many(pvals, pcount, 'j', ", ", NULL, 0, NULL);
+    char *pbuf1 = malloc(plen + 1);
+    char *pbuf2 = malloc(plen + 1);
+    ryu_string_many(pvals, pcount, 'j', ", ", pbuf1, plen + 1, NULL);
+    assert(ryu_string_many_parallel(pvals, pcount, 'j', ", ", pbuf2, plen + 1,
+        plens, run_reversed, NULL) == plen);
+    assert(strcmp(pbuf1, pbuf2) == 0);
+    assert(plens[pcount - 1] == ryu_length(pvals[pcount - 1], 'j'));
+    assert(ryu_string_many_parallel(pvals, pcount, 'j', ", ", pbuf2, 100,
+        NULL, run_reversed, NULL) == plen);
+    assert(strlen(pbuf2) == 99 && memcmp(pbuf1, pbuf2, 99) == 0);
+    free(pvals);
+    free(plens);
+    free(pbuf1);
+    free(pbuf2);
+    test_prec('f', 6, 3.14159265358979, "3.141593");
+    test_prec('f', 0, 2.5, "2");
+    test_prec('f', 0, 3.5, "4");
+    test_prec('f', 2, 0.125, "0.12");
+    test_prec('f', 1, 0.05, "0.1");
+    test_prec('f', 2, 9.995, "9.99");
+    test_prec('f', 1, 9.96, "10.0");
+    test_prec('f', 3, -0.0, "-0.000");
+    test_prec('f', 3, 1e-10, "0.000");
+    test_prec('f', 0, 1e22, "10000000000000000000000");
+    test_prec('f', 2, 1.7976931348623157e308, 
+        "17976931348623157081452742373170435679807056752584499659891747680315"
+        "72607800285387605895586327668781715404589535143824642343213268894641"
+        "82768467546703537516986049910576551282076245490090389328944075868508"
+        "45513394230458323690322294816580855933212334827479782620414472316873"
+        "8177180919299881250404026184124858368.00");
+    test_prec('f', 30, 5e-324, "0.000000000000000000000000000000");
+    test_prec('e', 3, 123456.0, "1.235e+05");
+    test_prec('e', 0, 9.5, "1e+01");
+    test_prec('E', 2, -0.000123456, "-1.23E-04");
+    test_prec('e', 2, 0.0, "0.00e+00");
+    test_prec('e', 16, 5e-324, "4.9406564584124654e-324");
+    test_prec('e', 3, 1e100, "1.000e+100");
+    test_prec('e', 3, NAN, "NaN");
+    test_prec('f', 3, -INFINITY, "-Infinity");
+    test_prec('g', 3, 1.0, "");
+    assert(ryu_string_precision(-3.14159, 'f', 4, mbuf, 5) == 7);
+    assert(strcmp(mbuf, "-3.1") == 0);
+    const char *fmts = "eEfgGjJ";
+    double lvals[] = { 0.0, -0.0, 1.5, -112.89123883, 1e21, 5e-324, 
+        1.7976931348623157e308, 123456789.0, NAN, -INFINITY };
+    for (size_t i = 0; i < sizeof(lvals) / sizeof(lvals[0]); i++) {
+        struct ryu_value v = ryu_decode(lvals[i]);
+        for (const char *f = fmts; *f; f++) {
+            char lbuf[400];
+            size_t n = ryu_string(lvals[i], *f, lbuf, sizeof(lbuf));
+            assert(ryu_length(lvals[i], *f) == n);
+            assert(ryu_value_length(v, *f) == n);
+            char vbuf[400];
+            assert(ryu_value_string(v, *f, vbuf, sizeof(vbuf)) == n);
+            assert(strcmp(lbuf, vbuf) == 0);
+        }
+    }
+    assert(ryu_length(1.0, 'x') == 0);
+    assert(ryu_value_string(ryu_decode_f16(0x3555), 'e', mbuf, 
+        sizeof(mbuf)) == 8);
+    assert(strcmp(mbuf, "3.333e-1") == 0);
+    assert(ryu_value_length(ryu_decode_bf16(0xc2f7), 'f') == 6);
+    assert(ryu_value_string(ryu_decode_f32(0.1f), 'f', mbuf, 
+        sizeof(mbuf)) == 3);
+    assert(strcmp(mbuf, "0.1") == 0);
+    uint64_t dm;
+    int32_t de;
+    bool ds;
+    assert(ryu_decompose(-112.89123883, &dm, &de, &ds));
+    assert(dm == 11289123883 && de == -8 && ds);
+    assert(ryu_decompose(5000.0, &dm, &de, &ds));
+    assert(dm == 5 && de == 3 && !ds);
+    assert(ryu_decompose(1e21, &dm, &de, &ds));
+    assert(dm == 1 && de == 21 && !ds);
+    assert(ryu_decompose(5e-324, &dm, &de, &ds));
+    assert(dm == 5 && de == -324 && !ds);
+    assert(ryu_decompose(-0.0, &dm, &de, &ds));
+    assert(dm == 0 && de == 0 && ds);
+    assert(!ryu_decompose(-INFINITY, &dm, &de, &ds));
+    assert(dm == 0 && ds);
+    assert(!ryu_decompose(NAN, &dm, &de, &ds));
+    assert(dm != 0);
+    struct ryu_stats st;
+    ryu_read_stats(&st, true);
+    ryu_string(NAN, 'j', mbuf, sizeof(mbuf));
+    ryu_string(-0.0, 'j', mbuf, sizeof(mbuf));
+    ryu_string(5000.0, 'j', mbuf, sizeof(mbuf));
+    ryu_string(1e21, 'j', mbuf, sizeof(mbuf));
+    ryu_string(0.3, 'e', mbuf, sizeof(mbuf));
+    ryu_read_stats(&st, false);
+#ifdef RYU_STATS
+    assert(st.special == 1 && st.zero == 1 && st.small_int == 1);
+    assert(st.general == 2 && st.fixed == 2 && st.exponent == 1);
+    ryu_read_stats(&st, true);
+    // Length queries, batches and writers count the form once per value.
+    ryu_length(0.5, 'j');
+    ryu_string(0.5, 'j', NULL, 0);
+    const double zeros[2] = { 0.0, 1e21 };
+    ryu_string_many(zeros, 2, 'j', ",", mbuf, sizeof(mbuf), NULL);
+    char swbuf[64];
+    struct ryu_writer sw = { .buf = swbuf, .cap = sizeof(swbuf) };
+    ryu_write_double(&sw, 0.5, 'g');
+    ryu_read_stats(&st, false);
+    assert(st.zero == 1 && st.general == 4);
+    assert(st.fixed == 4 && st.exponent == 1);
+    ryu_read_stats(&st, true);
+    ryu_read_stats(&st, false);
+#endif
+    assert(st.special + st.zero + st.small_int + st.general == 0);
+    static struct ryu_profile prof;
+    ryu_read_profile(&prof, true);
+    ryu_string(NAN, 'j', mbuf, sizeof(mbuf));
+    ryu_string(-0.0, 'j', mbuf, sizeof(mbuf));
+    ryu_string(5000.0, 'j', mbuf, sizeof(mbuf));
+    ryu_string(1e21, 'j', mbuf, sizeof(mbuf));
+    ryu_string(0.3, 'e', mbuf, sizeof(mbuf));
+    ryu_read_profile(&prof, false);
+    char pbuf[4096];
+#ifdef RYU_PROFILE
+    assert(prof.stages[5][RYU_PROFILE_TOTAL].count == 4);
+    assert(prof.stages[5][RYU_PROFILE_DECODE].count == 3);
+    assert(prof.stages[5][RYU_PROFILE_D2D].count == 1);
+    assert(prof.stages[5][RYU_PROFILE_PRINT].count == 2);
+    assert(prof.stages[0][RYU_PROFILE_D2D].count == 1);
+    size_t dlen = ryu_profile_dump(&prof, pbuf, sizeof(pbuf));
+    assert(dlen == strlen(pbuf) && strstr(pbuf, "\nj      d2d "));
+    assert(ryu_profile_dump(&prof, pbuf, 10) == dlen && strlen(pbuf) == 9);
+    // Batches add stages to the format but no total, which leaves the rest
+    // of ryu_string as it was.
+    ryu_read_profile(&prof, true);
+    for (int i = 0; i < 1000; i++) {
+        ryu_string(0.3 + i, 'j', mbuf, sizeof(mbuf));
+    }
+    ryu_read_profile(&prof, false);
+    const struct ryu_profile_stage *ps = prof.stages[5];
+    const uint64_t rest = ps[RYU_PROFILE_REST].ticks;
+    assert(ps[RYU_PROFILE_REST].count == 1000);
+    assert(rest + ps[RYU_PROFILE_DECODE].ticks + ps[RYU_PROFILE_D2D].ticks + 
+        ps[RYU_PROFILE_PRINT].ticks == ps[RYU_PROFILE_TOTAL].ticks);
+    const double pvals2[3] = { 0.3, 1e300, 5e-324 };
+    ryu_string_many(pvals2, 3, 'j', ",", mbuf, sizeof(mbuf), NULL);
+    ryu_read_profile(&prof, false);
+    assert(ps[RYU_PROFILE_DECODE].count == 1003);
+    assert(ps[RYU_PROFILE_REST].count == 1000);
+    assert(ps[RYU_PROFILE_REST].ticks == rest);
+    ryu_read_profile(&prof, true);
+    ryu_read_profile(&prof, false);
+#endif
+    assert(prof.stages[5][RYU_PROFILE_TOTAL].count == 0);
+    assert(ryu_profile_dump(&prof, pbuf, sizeof(pbuf)) == 66);
+    assert(strncmp(pbuf, "format stage ", 13) == 0 && pbuf[65] == '\n');
+    size_t (*fns[])(double, char[], size_t) = { ryu_string_e, ryu_string_E,
+        ryu_string_f, ryu_string_g, ryu_string_G, ryu_string_j, 
+        ryu_string_J };
+    for (size_t i = 0; i < sizeof(lvals) / sizeof(lvals[0]); i++) {
+        for (size_t k = 0; k < 7; k++) {
+            char b1[400], b2[400];
+            size_t n = ryu_string(lvals[i], fmts[k], b1, sizeof(b1));
+            assert(fns[k](lvals[i], b2, sizeof(b2)) == n);
+            assert(strcmp(b1, b2) == 0);
+            assert(fns[k](lvals[i], b2, 3) == n);
+            assert(strlen(b2) == (n < 2 ? n : 2));
+        }
+    }
+    char wbuf[8];
+    struct ryu_writer w = { .buf = wbuf, .cap = sizeof(wbuf), 
+        .flush = flush_sink };
+    for (size_t i = 0; i < 4; i++) {
+        if (i > 0) {
+            assert(ryu_write_bytes(&w, ",", 1) == 1);
+        }
+        assert(ryu_write_double(&w, vals[i], 'j') == lens[i]);
+    }
+    flush_sink(&w, 0);
+    assert(sinklen == nm && memcmp(sink, "1.5,-0.25,1e+21,NaN", nm) == 0);
+    assert(ryu_write_double(&w, -112.89123883, 'f') == 0);
+    assert(ryu_write_double(&w, 1.0, 'x') == 0);
+    w.flush = NULL;
+    assert(ryu_write_double(&w, 1.5, 'e') == 5 && w.len == 5);
+    assert(ryu_write_double(&w, 1.5, 'e') == 0 && w.len == 5);
+    assert(memcmp(wbuf, "1.5e0", 5) == 0);
+    struct ryu_options opts = { .format = 'J' };
+    assert(ryu_string_options(1e21, &opts, mbuf, sizeof(mbuf)) == 5);
+    assert(strcmp(mbuf, "1E+21") == 0);
+    opts = (struct ryu_options) { .exponent_sign = '-', .nan = "null" };
+    ryu_string_options(1e21, &opts, mbuf, sizeof(mbuf));
+    assert(strcmp(mbuf, "1e21") == 0);
+    ryu_string_options(NAN, &opts, mbuf, sizeof(mbuf));
+    assert(strcmp(mbuf, "null") == 0);
+    ryu_string_options(-INFINITY, &opts, mbuf, sizeof(mbuf));
+    assert(strcmp(mbuf, "-Infinity") == 0);
+    opts = (struct ryu_options) { .format = 'g', .dotzero = true, 
+        .point = ',' };
+    double ovals[] = { 5.0, -0.0, 500.0, 5000.0, 1.5, 1.5e-7, 1e300 };
+    size_t olens[7];
+    assert(ryu_string_many_options(ovals, 7, &opts, ";", mbuf, sizeof(mbuf),
+        olens) == 35);
+    assert(strcmp(mbuf, "5,0;-0,0;500,0;5e3;1,5;1,5e-7;1e300") == 0);
+    assert(olens[0] == 3 && olens[1] == 4 && olens[6] == 5);
+    assert(ryu_string_options(500.0, &opts, mbuf, 4) == 5);
+    assert(strcmp(mbuf, "500") == 0);
+    opts = (struct ryu_options) { .format = 'j', .dotzero = true };
+    ryu_string_options(123456789012345680000.0, &opts, mbuf, sizeof(mbuf));
+    assert(strcmp(mbuf, "123456789012345680000.0") == 0);
+    assert(ryu_string_options(-112.89123883, NULL, mbuf, sizeof(mbuf)) == 13);
+    assert(strcmp(mbuf, "-112.89123883") == 0);
+    opts.format = 'x';
+    assert(ryu_string_options(1.5, &opts, mbuf, sizeof(mbuf)) == 0);
+    assert(mbuf[0] == '\0');
+    assert(ryu_u64(0, mbuf, sizeof(mbuf)) == 1 && strcmp(mbuf, "0") == 0);
+    assert(ryu_u64(UINT64_MAX, mbuf, sizeof(mbuf)) == 20);
+    assert(strcmp(mbuf, "18446744073709551615") == 0);
+    assert(ryu_i64(INT64_MIN, mbuf, sizeof(mbuf)) == 20);
+    assert(strcmp(mbuf, "-9223372036854775808") == 0);
+    assert(ryu_i64(-100000000000000000, mbuf, 6) == 19);
+    assert(strcmp(mbuf, "-1000") == 0);
+    int64_t ivals[] = { 42, -7, 1000000000000000000, 0 };
+    size_t ilens[4];
+    assert(ryu_i64_many(ivals, 4, ",", mbuf, sizeof(mbuf), ilens) == 27);
+    assert(strcmp(mbuf, "42,-7,1000000000000000000,0") == 0);
+    assert(ilens[0] == 2 && ilens[1] == 2 && ilens[2] == 19 && ilens[3] == 1);
+    uint64_t uvals[] = { 1, UINT64_MAX };
+    assert(ryu_u64_many(uvals, 2, " ", mbuf, sizeof(mbuf), NULL) == 22);
+    assert(strcmp(mbuf, "1 18446744073709551615") == 0);
+    w.len = 0;
+    assert(ryu_write_i64(&w, -12) == 3 && ryu_write_u64(&w, 99) == 2);
+    assert(ryu_write_i64(&w, INT64_MIN) == 0 && w.len == 5);
+    assert(memcmp(wbuf, "-1299", 5) == 0);
+    struct ryu_series series = { .fmt = 'j' };
+    const double svals[] = { 1697059200.001, 1697059200.002, 1697059200.002,
+        1697059199.999, 12.5, 12.0, -0.5, 0.5, 1e21, 3e21, NAN, NAN, 1e-30 };
+    for (size_t i = 0; i < sizeof(svals) / sizeof(svals[0]); i++) {
+        char want[64];
+        const size_t n = ryu_string(svals[i], 'j', want, sizeof(want));
+        assert(ryu_series_string(&series, svals[i], mbuf, sizeof(mbuf)) == n);
+        assert(strcmp(mbuf, want) == 0);
+    }
+    series = (struct ryu_series) { .fmt = 'e' };
+    assert(ryu_series_string(&series, 1.25, mbuf, sizeof(mbuf)) == 6);
+    assert(ryu_series_string(&series, 1.75, mbuf, 4) == 6);
+    assert(strcmp(mbuf, "1.7") == 0);
+    assert(ryu_series_string(&series, -1.75, mbuf, sizeof(mbuf)) == 7);
+    assert(strcmp(mbuf, "-1.75e0") == 0);
+    series.fmt = 'f';
+    assert(ryu_series_string(&series, -1.75, mbuf, sizeof(mbuf)) == 5);
+    assert(strcmp(mbuf, "-1.75") == 0);
+    series.fmt = 'E';
+    assert(ryu_series_string(&series, -1.25, mbuf, sizeof(mbuf)) == 7);
+    assert(strcmp(mbuf, "-1.25E0") == 0);
+    series.fmt = 'x';
+    assert(ryu_series_string(&series, 1.5, mbuf, sizeof(mbuf)) == 0);
+    series = (struct ryu_series) { 0 };
+    w.len = 0;
+    assert(ryu_write_series(&w, &series, 0.25) == 4);
+    assert(ryu_write_series(&w, &series, 0.75) == 4 && w.len == 8);
+    assert(ryu_write_series(&w, &series, 0.5) == 0 && w.len == 8);
+    assert(memcmp(wbuf, "0.250.75", 8) == 0);
     test('f', 5000000000000000000.0, "5000000000000000000");
     test('e', 5000000000000000000.0, "5e18");
     test('g', 5000000000000000000.0, "5e18");
@@ -105,6 +574,12 @@ int main(void) {
     test('e', -5000000000000000000111.0, "-5e21");
     test('g', -5000000000000000000111.0, "-5e21");
     test('j', -5000000000000000000111.0, "-5e+21");
+    test('e', 1e5, "1e5");
+    test('e', -1e5, "-1e5");
+    test('E', -1e-5, "-1E-5");
+    test('e', 5e-324, "5e-324");
+    test('j', -5e-324, "-5e-324");
+    test('J', 1.7976931348623157e308, "1.7976931348623157E+308");
     test('f', 5000, "5000");
     test('g', 5000, "5e3");
     test('f', 500, "500");
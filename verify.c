@@ -0,0 +1,675 @@
+// Verifies every ryu conversion path against an independent reference, over
+// random 64-bit patterns, every exponent boundary, every fp16 and bfloat16,
+// and every float.
+//
+//   cc -O3 -pthread verify.c ryu.c -o verify -lm
+//   ./verify [-t threads] [-n random-values] [-f32 [first count]]
+//
+// The reference finds the shortest digits that round trip with the libc
+// snprintf and strtod, and formats them with the rules of each ryu format.
+// Each value is checked against ryu_string, the ryu_string_<fmt> entry points,
+// ryu_length, ryu_value_string, ryu_string_options, ryu_write_double,
+// ryu_string_many, ryu_series_string, truncated outputs, ryu_parse and
+// ryu_parse_many. Floats are checked with ryu_string_f32 and ryu_decode_f32.
+// The 16-bit formats have no libc parser, so their digits are checked against
+// the exact rounding interval instead, and each value goes through
+// ryu_string_f16, ryu_decode_f16 and ryu_string_many_f16, or the bf16
+// versions. Mismatches are printed, and the program exits with a non-zero
+// status if there were any.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "ryu.h"
+
+#define MAX_THREADS 256
+#define BATCH 64
+#define MAX_REPORTS 20
+
+static const char fmts[] = "eEfgGjJ";
+
+static size_t (* const fmt_fns[])(double, char[], size_t) = {
+    ryu_string_e, ryu_string_E, ryu_string_f, ryu_string_g, ryu_string_G,
+    ryu_string_j, ryu_string_J,
+};
+
+static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+static int reports;
+
+static void report(const char *path, char fmt, double d, const char *want,
+    const char *got)
+{
+    pthread_mutex_lock(&report_lock);
+    if (reports++ < MAX_REPORTS) {
+        fprintf(stderr, "mismatch: %s '%c' %.17g: want \"%s\", got \"%s\"\n",
+            path, fmt, d, want, got);
+    }
+    pthread_mutex_unlock(&report_lock);
+}
+
+// The shortest decimal that round trips: the digits, without a point, and
+// the decimal exponent of the first digit.
+struct ref {
+    char digits[24];
+    int n;
+    int exp;
+};
+
+// The exact decimal expansion of a double, like struct ref.
+struct exact {
+    char digits[800];
+    int n;
+    int exp;
+};
+
+static void exact_decimal(double d, struct exact *x) {
+    char buf[832];
+    snprintf(buf, sizeof(buf), "%.780e", d);
+    x->n = 0;
+    const char *p = buf;
+    for (; *p != 'e'; p++) {
+        if (*p != '.') {
+            x->digits[x->n++] = *p;
+        }
+    }
+    while (x->n > 1 && x->digits[x->n - 1] == '0') {
+        x->n--;
+    }
+    x->exp = atoi(p + 1);
+}
+
+// Compares the positive decimals a and b, which have a digits and b digits.
+static int cmp_decimal(const char *a, int an, int aexp, const char *b,
+    int bn, int bexp)
+{
+    if (aexp != bexp) {
+        return aexp < bexp ? -1 : 1;
+    }
+    for (int i = 0; i < an || i < bn; i++) {
+        const char x = i < an ? a[i] : '0';
+        const char y = i < bn ? b[i] : '0';
+        if (x != y) {
+            return x < y ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// The rounding interval of a value of a 16-bit format, which has no libc
+// parser. Decimals in the interval round to the value.
+struct interval {
+    struct exact lo;
+    struct exact hi;
+    bool inclusive;
+};
+
+// Returns true if the decimal digits * 10^(exp-n+1) parses to d, using the
+// interval iv if it is not NULL, and else the libc, as a float if f32 is set.
+static bool round_trips(const char *digits, int n, int exp, double d,
+    bool f32, const struct interval *iv)
+{
+    if (iv) {
+        const int lo = cmp_decimal(digits, n, exp, iv->lo.digits, iv->lo.n,
+            iv->lo.exp);
+        const int hi = cmp_decimal(digits, n, exp, iv->hi.digits, iv->hi.n,
+            iv->hi.exp);
+        return (lo > 0 || (lo == 0 && iv->inclusive)) &&
+            (hi < 0 || (hi == 0 && iv->inclusive));
+    }
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*se%d", n, digits, exp - n + 1);
+    if (f32) {
+        return strtof(buf, NULL) == (float) d;
+    }
+    return strtod(buf, NULL) == d;
+}
+
+// Sets r to the n-digit decimal nearest to d, or to the nearest of its
+// neighbors that round trips when the nearest does not. Like ryu, a neighbor
+// that carries into the next power of ten is preferred when it round trips,
+// which only matters for the smallest bfloat16, whose interval is wide
+// enough to hold both 9e-41 and 1e-40. Returns false if no n-digit decimal
+// round trips.
+static bool ref_digits(double d, bool f32, const struct interval *iv, int n,
+    struct ref *r)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*e", n - 1, d);
+    // "d.ddde[+-]x" into an integer mantissa m, scaled by 10^(exp-n+1).
+    uint64_t m = (uint64_t) (buf[0] - '0');
+    const char *p = buf + 1 + (n > 1);
+    for (int i = 1; i < n; i++) {
+        m = m * 10 + (uint64_t) (*p++ - '0');
+    }
+    const int exp = atoi(p + 1);
+    const uint64_t cands[4] = { m + 1, m, m - 1, m + 1 };
+    for (int i = 0; i < 4; i++) {
+        if (cands[i] == 0) {
+            continue;
+        }
+        // Normalize, the neighbors may have gained or lost a digit.
+        char digits[24];
+        int len = snprintf(digits, sizeof(digits), "%" PRIu64, cands[i]);
+        const int e = exp + (len - n);
+        if (i == 0 && len == n) {
+            continue;
+        }
+        while (len > 1 && digits[len - 1] == '0') {
+            len--;
+        }
+        if (round_trips(digits, len, e, d, f32, iv)) {
+            memcpy(r->digits, digits, (size_t) len);
+            r->digits[len] = '\0';
+            r->n = len;
+            r->exp = e;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Finds the shortest decimal for the finite, non-zero, positive d. The
+// length of the ryu output is used as the first guess.
+static void ref_shortest(double d, bool f32, const struct interval *iv,
+    int guess, struct ref *r)
+{
+    const int max = f32 ? 9 : 17;
+    int n = guess < 1 ? 1 : guess > max ? max : guess;
+    if (ref_digits(d, f32, iv, n, r)) {
+        while (n > 1 && ref_digits(d, f32, iv, n - 1, r)) {
+            n--;
+        }
+        ref_digits(d, f32, iv, n, r);
+        return;
+    }
+    while (!ref_digits(d, f32, iv, ++n, r)) { }
+}
+
+static int ref_exp_form(const struct ref *r, bool sign, char ech, bool plus,
+    char *out)
+{
+    int k = 0;
+    if (sign) {
+        out[k++] = '-';
+    }
+    out[k++] = r->digits[0];
+    if (r->n > 1) {
+        out[k++] = '.';
+        memcpy(out + k, r->digits + 1, (size_t) r->n - 1);
+        k += r->n - 1;
+    }
+    out[k++] = ech;
+    if (plus && r->exp >= 0) {
+        out[k++] = '+';
+    }
+    k += sprintf(out + k, "%d", r->exp);
+    return k;
+}
+
+static int ref_fixed_form(const struct ref *r, bool sign, char *out) {
+    int k = 0;
+    if (sign) {
+        out[k++] = '-';
+    }
+    if (r->exp < 0) {
+        out[k++] = '0';
+        out[k++] = '.';
+        for (int i = 0; i < -r->exp - 1; i++) {
+            out[k++] = '0';
+        }
+        memcpy(out + k, r->digits, (size_t) r->n);
+        k += r->n;
+    } else if (r->exp >= r->n - 1) {
+        memcpy(out + k, r->digits, (size_t) r->n);
+        k += r->n;
+        for (int i = 0; i < r->exp - r->n + 1; i++) {
+            out[k++] = '0';
+        }
+    } else {
+        memcpy(out + k, r->digits, (size_t) r->exp + 1);
+        k += r->exp + 1;
+        out[k++] = '.';
+        memcpy(out + k, r->digits + r->exp + 1, (size_t) (r->n - r->exp - 1));
+        k += r->n - r->exp - 1;
+    }
+    return k;
+}
+
+// Formats the reference like ryu_string.
+static void ref_format(const struct ref *r, bool sign, char fmt, char *out) {
+    char e[64], f[400];
+    const bool upper = fmt == 'E' || fmt == 'G' || fmt == 'J';
+    const bool plus = fmt == 'j' || fmt == 'J';
+    const int elen = ref_exp_form(r, sign, upper ? 'E' : 'e', plus, e);
+    const int flen = ref_fixed_form(r, sign, f);
+    e[elen] = '\0';
+    f[flen] = '\0';
+    bool fixed;
+    switch (fmt) {
+    case 'f':
+        fixed = true;
+        break;
+    case 'g': case 'G':
+        fixed = flen <= elen;
+        break;
+    case 'j': case 'J':
+        fixed = flen <= 21 + sign;
+        break;
+    default:
+        fixed = false;
+    }
+    strcpy(out, fixed ? f : e);
+}
+
+// Sets want to the reference output of d in each format.
+static void reference(double d, bool f32, const struct interval *iv,
+    int guess, char want[][400])
+{
+    const bool sign = signbit(d) != 0;
+    for (int k = 0; fmts[k]; k++) {
+        if (isnan(d)) {
+            strcpy(want[k], "NaN");
+        } else if (isinf(d)) {
+            strcpy(want[k], sign ? "-Infinity" : "Infinity");
+        }
+    }
+    if (!isfinite(d)) {
+        return;
+    }
+    struct ref r;
+    if (d == 0) {
+        strcpy(r.digits, "0");
+        r.n = 1;
+        r.exp = 0;
+    } else {
+        ref_shortest(fabs(d), f32, iv, guess, &r);
+    }
+    for (int k = 0; fmts[k]; k++) {
+        ref_format(&r, sign, fmts[k], want[k]);
+    }
+}
+
+struct worker {
+    pthread_t thread;
+    uint64_t seed;
+    // The values to check, as indices into list or float bit patterns.
+    uint64_t first;
+    uint64_t count;
+    const double *list;
+    uint64_t values;
+    uint64_t conversions;
+    uint64_t mismatches;
+};
+
+static uint64_t rand64(uint64_t *seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static double bits_to_double(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(double));
+    return d;
+}
+
+static float bits_to_float(uint32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(float));
+    return f;
+}
+
+static void check(struct worker *w, const char *path, char fmt, double d,
+    const char *want, const char *got, size_t n)
+{
+    w->conversions++;
+    if (n != strlen(want) || strcmp(want, got) != 0) {
+        w->mismatches++;
+        report(path, fmt, d, want, got);
+    }
+}
+
+// Returns the number of digits before the exponent of an 'e' output.
+static int digit_count(const char *s) {
+    int n = 0;
+    for (; *s && *s != 'e'; s++) {
+        n += *s >= '0' && *s <= '9';
+    }
+    return n;
+}
+
+// Checks every path for one double. The batch paths are checked by
+// check_batch.
+static void check_double(struct worker *w, double d, char want[][400]) {
+    char got[400];
+    ryu_string(d, 'e', got, sizeof(got));
+    reference(d, false, NULL, digit_count(got), want);
+    const struct ryu_value v = ryu_decode(d);
+    for (int k = 0; fmts[k]; k++) {
+        const char fmt = fmts[k];
+        size_t n = ryu_string(d, fmt, got, sizeof(got));
+        check(w, "ryu_string", fmt, d, want[k], got, n);
+        n = fmt_fns[k](d, got, sizeof(got));
+        check(w, "ryu_string_<fmt>", fmt, d, want[k], got, n);
+        n = ryu_value_string(v, fmt, got, sizeof(got));
+        check(w, "ryu_value_string", fmt, d, want[k], got, n);
+        const struct ryu_options opts = { .format = fmt };
+        n = ryu_string_options(d, &opts, got, sizeof(got));
+        check(w, "ryu_string_options", fmt, d, want[k], got, n);
+        w->conversions += 2;
+        if (ryu_length(d, fmt) != strlen(want[k]) ||
+            ryu_value_length(v, fmt) != strlen(want[k]))
+        {
+            w->mismatches++;
+            report("ryu_length", fmt, d, want[k], "");
+        }
+        struct ryu_writer wr = { .buf = got, .cap = sizeof(got) - 1 };
+        n = ryu_write_double(&wr, d, fmt);
+        got[wr.len] = '\0';
+        check(w, "ryu_write_double", fmt, d, want[k], got, n);
+        // A truncated copy is a null-terminated prefix.
+        const size_t len = strlen(want[k]);
+        const size_t nbytes = (size_t) (rand64(&w->seed) % (len + 1));
+        memset(got, 'x', sizeof(got));
+        n = ryu_string(d, fmt, nbytes ? got : NULL, nbytes);
+        w->conversions++;
+        if (n != len || (nbytes > 0 && (strncmp(got, want[k], nbytes - 1) != 0
+            || got[nbytes - 1] != '\0')) || got[nbytes] != 'x')
+        {
+            w->mismatches++;
+            report("truncated ryu_string", fmt, d, want[k],
+                nbytes ? got : "");
+        }
+    }
+    if (isfinite(d)) {
+        double p;
+        w->conversions++;
+        if (ryu_parse(want[0], strlen(want[0]), &p) != strlen(want[0]) ||
+            memcmp(&p, &d, sizeof(double)) != 0)
+        {
+            w->mismatches++;
+            report("ryu_parse", 'e', d, want[0], "");
+        }
+    }
+}
+
+// Checks ryu_string_many for a batch, against the reference outputs.
+static void check_batch(struct worker *w, const double *vals, size_t n,
+    char want[][7][400])
+{
+    static _Thread_local char exp[BATCH * 401], got[BATCH * 401];
+    for (int k = 0; fmts[k]; k++) {
+        size_t len = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (i > 0) {
+                exp[len++] = ';';
+            }
+            const size_t n1 = strlen(want[i][k]);
+            memcpy(exp + len, want[i][k], n1 + 1);
+            len += n1;
+        }
+        const size_t m = ryu_string_many(vals, n, fmts[k], ";", got,
+            sizeof(got), NULL);
+        check(w, "ryu_string_many", fmts[k], vals[0], exp, got, m);
+        // A series of neighbouring values, such as the boundaries, reuses
+        // the previous output.
+        struct ryu_series series = { .fmt = fmts[k] };
+        for (size_t i = 0; i < n; i++) {
+            const size_t sn = ryu_series_string(&series, vals[i], got,
+                sizeof(got));
+            check(w, "ryu_series_string", fmts[k], vals[i], want[i][k], got,
+                sn);
+        }
+        // And back, with the values that do not parse reported as NaN.
+        double parsed[BATCH];
+        size_t error;
+        const size_t count = ryu_parse_many(exp, len, ";", parsed, BATCH,
+            &error);
+        w->conversions++;
+        bool same = count == n && error == len;
+        for (size_t i = 0; same && i < n; i++) {
+            same = isnan(vals[i]) ? isnan(parsed[i]) :
+                memcmp(&parsed[i], &vals[i], sizeof(double)) == 0;
+        }
+        if (!same) {
+            w->mismatches++;
+            report("ryu_parse_many", fmts[k], vals[0], exp, "");
+        }
+    }
+}
+
+static void check_doubles(struct worker *w, const double *vals, size_t n) {
+    static _Thread_local char want[BATCH][7][400];
+    for (size_t i = 0; i < n; i++) {
+        check_double(w, vals[i], want[i]);
+    }
+    check_batch(w, vals, n, want);
+    w->values += n;
+}
+
+static void check_float(struct worker *w, float f) {
+    char want[7][400], got[400];
+    const double d = f;
+    ryu_string_f32(f, 'e', got, sizeof(got));
+    reference(d, true, NULL, digit_count(got), want);
+    const struct ryu_value v = ryu_decode_f32(f);
+    for (int k = 0; fmts[k]; k++) {
+        size_t n = ryu_string_f32(f, fmts[k], got, sizeof(got));
+        check(w, "ryu_string_f32", fmts[k], d, want[k], got, n);
+        n = ryu_value_string(v, fmts[k], got, sizeof(got));
+        check(w, "ryu_decode_f32", fmts[k], d, want[k], got, n);
+    }
+    w->values++;
+}
+
+// Converts the bits of an fp16, or of a bfloat16 if bfloat is set, to a double
+// and sets iv to its rounding interval if it is finite.
+static double half_value(uint16_t bits, bool bfloat, struct interval *iv) {
+    const int mbits = bfloat ? 7 : 10, ebits = bfloat ? 8 : 5;
+    const int bias = (1 << (ebits - 1)) - 1;
+    const int e = (bits >> mbits) & ((1 << ebits) - 1);
+    const int m = bits & ((1 << mbits) - 1);
+    const double sign = bits >> 15 ? -1.0 : 1.0;
+    if (e == (1 << ebits) - 1) {
+        return m ? NAN : sign * INFINITY;
+    }
+    // The gap below the value is half as wide at the bottom of an exponent.
+    const double ulp = ldexp(1.0, (e ? e : 1) - bias - mbits);
+    const double x = e ? ldexp(m | 1 << mbits, e - bias - mbits) :
+        ldexp(m, 1 - bias - mbits);
+    exact_decimal(x + ulp / 2, &iv->hi);
+    exact_decimal(x - (m == 0 && e > 1 ? ulp / 4 : ulp / 2), &iv->lo);
+    iv->inclusive = (m & 1) == 0;
+    return sign * x;
+}
+
+// Checks one fp16 or bfloat16, including as a batch of one.
+static void check_half(struct worker *w, uint16_t bits, bool bfloat) {
+    char want[7][400], got[400];
+    struct interval iv;
+    const double d = half_value(bits, bfloat, &iv);
+    size_t (* const string)(uint16_t, char, char[], size_t) = bfloat ?
+        ryu_string_bf16 : ryu_string_f16;
+    const char *name = bfloat ? "ryu_string_bf16" : "ryu_string_f16";
+    string(bits, 'e', got, sizeof(got));
+    reference(d, false, &iv, digit_count(got), want);
+    const struct ryu_value v = bfloat ? ryu_decode_bf16(bits) :
+        ryu_decode_f16(bits);
+    for (int k = 0; fmts[k]; k++) {
+        size_t n = string(bits, fmts[k], got, sizeof(got));
+        check(w, name, fmts[k], d, want[k], got, n);
+        n = ryu_value_string(v, fmts[k], got, sizeof(got));
+        check(w, bfloat ? "ryu_decode_bf16" : "ryu_decode_f16", fmts[k], d,
+            want[k], got, n);
+        size_t len;
+        n = (bfloat ? ryu_string_many_bf16 : ryu_string_many_f16)(&bits, 1,
+            fmts[k], ",", got, sizeof(got), &len);
+        check(w, bfloat ? "ryu_string_many_bf16" : "ryu_string_many_f16",
+            fmts[k], d, want[k], got, len == n ? n : 0);
+    }
+    w->values++;
+}
+
+static void *run_f16(void *arg) {
+    struct worker *w = arg;
+    for (uint64_t i = 0; i < w->count; i++) {
+        const uint64_t bits = w->first + i;
+        check_half(w, (uint16_t) bits, bits >> 16);
+    }
+    return NULL;
+}
+
+static void *run_random(void *arg) {
+    struct worker *w = arg;
+    double vals[BATCH];
+    for (uint64_t i = 0; i < w->count; i += BATCH) {
+        const size_t n = w->count - i < BATCH ? (size_t) (w->count - i) : BATCH;
+        for (size_t j = 0; j < n; j++) {
+            vals[j] = bits_to_double(rand64(&w->seed));
+        }
+        check_doubles(w, vals, n);
+    }
+    return NULL;
+}
+
+static void *run_list(void *arg) {
+    struct worker *w = arg;
+    for (uint64_t i = 0; i < w->count; i += BATCH) {
+        const size_t n = w->count - i < BATCH ? (size_t) (w->count - i) : BATCH;
+        check_doubles(w, w->list + w->first + i, n);
+    }
+    return NULL;
+}
+
+static void *run_f32(void *arg) {
+    struct worker *w = arg;
+    for (uint64_t i = 0; i < w->count; i++) {
+        check_float(w, bits_to_float((uint32_t) (w->first + i)));
+    }
+    return NULL;
+}
+
+// Every exponent with the smallest, largest and a few other mantissas, the
+// neighbors of every power of ten, and the boundaries of the small integer
+// and 'j' fixed-point paths. Returns the number of values.
+static size_t boundaries(double **list) {
+    const size_t cap = 2047 * 6 * 2 + 633 * 5 * 2 + 64;
+    double *l = malloc(cap * sizeof(double));
+    size_t n = 0;
+    static const uint64_t mantissas[] = { 0, 1, 2, (1ull << 51),
+        (1ull << 52) - 2, (1ull << 52) - 1 };
+    for (uint64_t e = 0; e < 2047; e++) {
+        for (size_t i = 0; i < 6; i++) {
+            const uint64_t bits = e << 52 | mantissas[i];
+            l[n++] = bits_to_double(bits);
+            l[n++] = bits_to_double(bits | 1ull << 63);
+        }
+    }
+    for (int e = -324; e <= 308; e++) {
+        char s[16];
+        snprintf(s, sizeof(s), "1e%d", e);
+        const double p = strtod(s, NULL);
+        const double down = nextafter(p, 0);
+        const double vals[5] = { p, down, nextafter(down, 0),
+            nextafter(p, INFINITY), nextafter(nextafter(p, INFINITY),
+            INFINITY) };
+        for (int i = 0; i < 5; i++) {
+            l[n++] = vals[i];
+            l[n++] = -vals[i];
+        }
+    }
+    static const double edges[] = { 9007199254740991.0, 9007199254740992.0,
+        9007199254740994.0, 1e16, 1e17, 99999999999999999999.0, 1e21,
+        999999999999999900000.0, 1.0000000000000001e21, 4294967295.0,
+        4294967296.0, 0.5, 1.5, NAN, INFINITY };
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        l[n++] = edges[i];
+        l[n++] = -edges[i];
+    }
+    *list = l;
+    return n;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+// Splits count values over the threads, runs them, and prints the totals.
+static uint64_t run(const char *name, void *(*fn)(void *), uint64_t first,
+    uint64_t count, const double *list, int nthreads)
+{
+    static struct worker ws[MAX_THREADS];
+    const double start = now();
+    for (int i = 0; i < nthreads; i++) {
+        const uint64_t lo = count / (uint64_t) nthreads * (uint64_t) i;
+        const uint64_t hi = i == nthreads - 1 ? count :
+            count / (uint64_t) nthreads * (uint64_t) (i + 1);
+        ws[i] = (struct worker) { .seed = 88172645463325252ull +
+            (uint64_t) i * 0x9E3779B97F4A7C15ull, .first = first + lo,
+            .count = hi - lo, .list = list };
+        pthread_create(&ws[i].thread, NULL, fn, &ws[i]);
+    }
+    uint64_t values = 0, conversions = 0, mismatches = 0;
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(ws[i].thread, NULL);
+        values += ws[i].values;
+        conversions += ws[i].conversions;
+        mismatches += ws[i].mismatches;
+    }
+    const double secs = now() - start;
+    printf("%-12s %12" PRIu64 " values %14" PRIu64 " conversions %8.2f M/s "
+        "%" PRIu64 " mismatches\n", name, values, conversions,
+        (double) conversions / secs / 1e6, mismatches);
+    return mismatches;
+}
+
+int main(int argc, char **argv) {
+    int nthreads = 4;
+    uint64_t nrandom = 1000000;
+    bool f32 = false;
+    uint64_t f32_first = 0, f32_count = 1ull << 32;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            nthreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            nrandom = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-f32") == 0) {
+            f32 = true;
+            if (i + 2 < argc && argv[i + 1][0] != '-') {
+                f32_first = strtoull(argv[++i], NULL, 0);
+                f32_count = strtoull(argv[++i], NULL, 0);
+            }
+        } else {
+            fprintf(stderr, "usage: %s [-t threads] [-n random-values] "
+                "[-f32 [first count]]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (nthreads < 1 || nthreads > MAX_THREADS) {
+        nthreads = 4;
+    }
+    double *list;
+    const size_t nlist = boundaries(&list);
+    uint64_t mismatches = run("boundaries", run_list, 0, nlist, list,
+        nthreads);
+    mismatches += run("random bits", run_random, 0, nrandom, NULL, nthreads);
+    mismatches += run("fp16/bf16", run_f16, 0, 1u << 17, NULL, nthreads);
+    if (f32) {
+        if (f32_first + f32_count > 1ull << 32) {
+            f32_count = (1ull << 32) - f32_first;
+        }
+        mismatches += run("floats", run_f32, f32_first, f32_count, NULL,
+            nthreads);
+    }
+    free(list);
+    return mismatches != 0;
+}